@@ -85,7 +85,7 @@ int main() {
         predictedEntryTable.y = -1.0f;
 
         if (puckDetected) {
-            PuckPosition puckPos = {capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight()), currentTimeUs};
+            PuckPosition puckPos = {capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight()), capture.getFrameMetadata().rowTimestampUs(puckCenter.y)};
             predictor.addMeasurement(puckPos);
 
             // Only predict if puck is outside defense zone
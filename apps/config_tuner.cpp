@@ -37,6 +37,7 @@ int main() {
     int table_detect_threshold = config.TABLE_DETECT_THRESHOLD;
     int puck_min_area = config.PUCK_MIN_AREA;
     int puck_max_area = config.PUCK_MAX_AREA;
+    int puck_min_circularity = (int)(config.PUCK_MIN_CIRCULARITY * 100);
     int defense_zone_height = (int)(config.DEFENSE_ZONE_HEIGHT * 10);
     int defense_zone_width = (int)(config.DEFENSE_ZONE_WIDTH * 10);
     int where_defense_zone = config.WHERE_DEFENSE_ZONE;
@@ -47,6 +48,7 @@ int main() {
     cv::createTrackbar("TABLE_DETECT_THRESHOLD", "Parameter Controls", &table_detect_threshold, 255);
     cv::createTrackbar("PUCK_MIN_AREA", "Parameter Controls", &puck_min_area, 10000);
     cv::createTrackbar("PUCK_MAX_AREA", "Parameter Controls", &puck_max_area, 100000);
+    cv::createTrackbar("PUCK_MIN_CIRCULARITY*100", "Parameter Controls", &puck_min_circularity, 100);
     cv::createTrackbar("DEFENSE_ZONE_HEIGHT*10", "Parameter Controls", &defense_zone_height, 5000);  // 0-500 mm
     cv::createTrackbar("DEFENSE_ZONE_WIDTH*10", "Parameter Controls", &defense_zone_width, 5000);
     cv::createTrackbar("WHERE_DEFENSE_ZONE", "Parameter Controls", &where_defense_zone, 3);
@@ -72,13 +74,17 @@ int main() {
         config.TABLE_DETECT_THRESHOLD = table_detect_threshold;
         config.PUCK_MIN_AREA = puck_min_area;
         config.PUCK_MAX_AREA = puck_max_area;
+        config.PUCK_MIN_CIRCULARITY = puck_min_circularity / 100.0f;
         config.DEFENSE_ZONE_HEIGHT = defense_zone_height / 10.0f;
         config.DEFENSE_ZONE_WIDTH = defense_zone_width / 10.0f;
         if (config.WHERE_DEFENSE_ZONE != where_defense_zone) {
             config.WHERE_DEFENSE_ZONE = where_defense_zone;
             predictor.setDefenseZone(where_defense_zone);
         }
-        config.robot_origin_corner = robot_origin_corner;
+        if (config.robot_origin_corner != robot_origin_corner) {
+            config.robot_origin_corner = robot_origin_corner;
+            mover.setOriginCorner(robot_origin_corner);
+        }
         cv::Mat frame = capture.captureImage();
         if (frame.empty()) {
             std::cerr << "Failed to capture frame." << std::endl;
@@ -123,7 +129,7 @@ int main() {
         predictedEntryTable.x = -1.0f;  // Initialize to invalid position
         predictedEntryTable.y = -1.0f;
         if (puckDetected) {
-            PuckPosition puckPos = {capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight()), currentTimeUs};
+            PuckPosition puckPos = {capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight()), capture.getFrameMetadata().rowTimestampUs(puckCenter.y)};
             predictor.addMeasurement(puckPos);
 
             // Only predict if puck is outside defense zone 
@@ -264,6 +270,7 @@ int main() {
             table_detect_threshold = config.TABLE_DETECT_THRESHOLD;
             puck_min_area = config.PUCK_MIN_AREA;
             puck_max_area = config.PUCK_MAX_AREA;
+            puck_min_circularity = (int)(config.PUCK_MIN_CIRCULARITY * 100);
             defense_zone_height = (int)(config.DEFENSE_ZONE_HEIGHT * 10);
             defense_zone_width = (int)(config.DEFENSE_ZONE_WIDTH * 10);
             where_defense_zone = config.WHERE_DEFENSE_ZONE;
@@ -273,12 +280,14 @@ int main() {
             cv::setTrackbarPos("TABLE_DETECT_THRESHOLD", "Parameter Controls", table_detect_threshold);
             cv::setTrackbarPos("PUCK_MIN_AREA", "Parameter Controls", puck_min_area);
             cv::setTrackbarPos("PUCK_MAX_AREA", "Parameter Controls", puck_max_area);
+            cv::setTrackbarPos("PUCK_MIN_CIRCULARITY*100", "Parameter Controls", puck_min_circularity);
             cv::setTrackbarPos("DEFENSE_ZONE_HEIGHT*10", "Parameter Controls", defense_zone_height);
             cv::setTrackbarPos("DEFENSE_ZONE_WIDTH*10", "Parameter Controls", defense_zone_width);
             cv::setTrackbarPos("WHERE_DEFENSE_ZONE", "Parameter Controls", where_defense_zone);
             cv::setTrackbarPos("ROBOT_ORIGIN_CORNER", "Parameter Controls", robot_origin_corner);
             // Update predictor with default defense zone
             predictor.setDefenseZone(where_defense_zone);
+            mover.setOriginCorner(robot_origin_corner);
             std::cout << "Config reset to defaults and sliders updated." << std::endl;
         }
         if (key == 'q' || key == 'Q') {
@@ -0,0 +1,334 @@
+#include "capture.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless sweep of puck detection parameters over a recorded session.
+// Frames are decoded once into memory and shared read-only by all worker threads;
+// every parameter point is scored against labels (or a self-consistent consensus
+// track when no labels are given) and the Pareto-best points are written as config files.
+
+static const int TIMING_RUNS = 3;            // cost is the fastest of this many passes over the frames
+static const double COST_TOLERANCE = 0.10;   // costs within 10% count as equal for the Pareto front
+static const size_t MAX_PARETO_CONFIGS = 20;  // config files written for the best front points
+
+struct SweepPoint {
+    int threshold;
+    int minArea;
+    int maxArea;
+    float minCircularity;
+};
+
+struct SweepResult {
+    SweepPoint point;
+    double detectionRate = 0.0;      // labeled puck frames with a detection within tolerance
+    int falsePositives = 0;          // detections on empty frames or away from the label
+    double falsePositiveRate = 0.0;  // false positives per frame
+    double msPerFrame = 0.0;         // detectPuck cost, fastest of TIMING_RUNS passes
+    std::vector<cv::Point2f> detections;
+};
+
+static void printUsage() {
+    std::cout << "Usage: detection_sweep <video|image_dir> [options]" << std::endl;
+    std::cout << "  --labels <csv>     Per-frame labels 'frame,x,y' in pixels (x < 0 = no puck)" << std::endl;
+    std::cout << "  --random <n>       Random search with n points instead of the default grid" << std::endl;
+    std::cout << "  --max-frames <n>   Only use the first n frames" << std::endl;
+    std::cout << "  --tolerance <px>   Max distance from the label to count as a hit (default 8)" << std::endl;
+    std::cout << "  --threads <n>      Worker threads (default: all cores)" << std::endl;
+    std::cout << "  --out <dir>        Output directory (default sweep_results)" << std::endl;
+}
+
+static bool loadFrames(const std::string& source, int maxFrames, std::vector<cv::Mat>& frames) {
+    auto addFrame = [&](const cv::Mat& img) {
+        cv::Mat gray;
+        if (img.channels() == 3) {
+            cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+        } else {
+            gray = img.clone();
+        }
+        frames.push_back(gray);
+    };
+
+    if (std::filesystem::is_directory(source)) {
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(source)) {
+            std::string ext = entry.path().extension().string();
+            if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp") files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            if (maxFrames > 0 && (int)frames.size() >= maxFrames) break;
+            cv::Mat img = cv::imread(file.string());
+            if (!img.empty()) addFrame(img);
+        }
+    } else {
+        cv::VideoCapture video(source);
+        if (!video.isOpened()) {
+            std::cerr << "Error: Could not open session: " << source << std::endl;
+            return false;
+        }
+        cv::Mat img;
+        while (video.read(img)) {
+            if (maxFrames > 0 && (int)frames.size() >= maxFrames) break;
+            addFrame(img);
+        }
+    }
+    return !frames.empty();
+}
+
+static bool loadLabels(const std::string& filename, size_t frameCount, std::vector<cv::Point2f>& labels) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open labels: " << filename << std::endl;
+        return false;
+    }
+    labels.assign(frameCount, cv::Point2f(-1, -1));
+    std::string line;
+    while (std::getline(file, line)) {
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream ss(line);
+        size_t index;
+        float x, y;
+        if (!(ss >> index >> x >> y)) continue;  // header or malformed line
+        if (index < frameCount) labels[index] = cv::Point2f(x, y);
+    }
+    return true;
+}
+
+// Per-frame median of all sweep detections, kept only where most points agree and
+// the track moves by a plausible amount between neighbouring frames.
+static std::vector<cv::Point2f> buildConsensusLabels(const std::vector<SweepResult>& results, size_t frameCount, float maxStepPx) {
+    std::vector<cv::Point2f> consensus(frameCount, cv::Point2f(-1, -1));
+    std::vector<float> xs, ys;
+    for (size_t f = 0; f < frameCount; ++f) {
+        xs.clear();
+        ys.clear();
+        for (const auto& r : results) {
+            const cv::Point2f& d = r.detections[f];
+            if (d.x >= 0 && d.y >= 0) {
+                xs.push_back(d.x);
+                ys.push_back(d.y);
+            }
+        }
+        if (xs.size() * 2 < results.size()) continue;
+        std::nth_element(xs.begin(), xs.begin() + xs.size() / 2, xs.end());
+        std::nth_element(ys.begin(), ys.begin() + ys.size() / 2, ys.end());
+        consensus[f] = cv::Point2f(xs[xs.size() / 2], ys[ys.size() / 2]);
+    }
+
+    std::vector<cv::Point2f> consistent(frameCount, cv::Point2f(-1, -1));
+    for (size_t f = 0; f < frameCount; ++f) {
+        if (consensus[f].x < 0) continue;
+        bool prevOk = f > 0 && consensus[f - 1].x >= 0 && cv::norm(consensus[f] - consensus[f - 1]) <= maxStepPx;
+        bool nextOk = f + 1 < frameCount && consensus[f + 1].x >= 0 && cv::norm(consensus[f] - consensus[f + 1]) <= maxStepPx;
+        if (prevOk || nextOk) consistent[f] = consensus[f];
+    }
+    return consistent;
+}
+
+static void scoreResult(SweepResult& result, const std::vector<cv::Point2f>& labels, float tolerancePx) {
+    int puckFrames = 0;
+    int hits = 0;
+    int falsePositives = 0;
+    for (size_t f = 0; f < labels.size(); ++f) {
+        const cv::Point2f& label = labels[f];
+        const cv::Point2f& d = result.detections[f];
+        bool hasLabel = label.x >= 0 && label.y >= 0;
+        bool hasDetection = d.x >= 0 && d.y >= 0;
+        if (hasLabel) puckFrames++;
+        if (!hasDetection) continue;
+        if (hasLabel && cv::norm(d - label) <= tolerancePx) {
+            hits++;
+        } else {
+            falsePositives++;
+        }
+    }
+    result.detectionRate = puckFrames > 0 ? (double)hits / puckFrames : 0.0;
+    result.falsePositives = falsePositives;
+    result.falsePositiveRate = labels.empty() ? 0.0 : (double)falsePositives / labels.size();
+}
+
+// Cost is measured while every core runs the sweep, so costs within COST_TOLERANCE are taken
+// as equal; between such points with the same detection and false positives the cheaper wins
+static bool dominates(const SweepResult& a, const SweepResult& b) {
+    bool costNoWorse = a.msPerFrame <= b.msPerFrame * (1.0 + COST_TOLERANCE);
+    bool costBetter = a.msPerFrame * (1.0 + COST_TOLERANCE) < b.msPerFrame;
+    bool noWorse = a.detectionRate >= b.detectionRate && a.falsePositiveRate <= b.falsePositiveRate && costNoWorse;
+    bool better = a.detectionRate > b.detectionRate || a.falsePositiveRate < b.falsePositiveRate || costBetter;
+    bool tieBreak = a.detectionRate == b.detectionRate && a.falsePositiveRate == b.falsePositiveRate && a.msPerFrame < b.msPerFrame;
+    return noWorse && (better || tieBreak);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return -1;
+    }
+
+    std::string source = argv[1];
+    std::string labelsFile;
+    std::string outDir = "sweep_results";
+    int randomPoints = 0;
+    int maxFrames = 0;
+    float tolerancePx = 8.0f;
+    int threadCount = (int)std::thread::hardware_concurrency();
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return -1;
+        }
+        if (arg == "--labels") labelsFile = argv[++i];
+        else if (arg == "--random") randomPoints = std::stoi(argv[++i]);
+        else if (arg == "--max-frames") maxFrames = std::stoi(argv[++i]);
+        else if (arg == "--tolerance") tolerancePx = std::stof(argv[++i]);
+        else if (arg == "--threads") threadCount = std::stoi(argv[++i]);
+        else if (arg == "--out") outDir = argv[++i];
+        else {
+            printUsage();
+            return -1;
+        }
+    }
+    if (threadCount < 1) threadCount = 1;
+
+    Config baseConfig;
+    baseConfig.loadFromFile();
+
+    // Decode the whole session once; workers only read these frames
+    std::vector<cv::Mat> frames;
+    if (!loadFrames(source, maxFrames, frames)) {
+        std::cerr << "Error: No frames loaded from " << source << std::endl;
+        return -1;
+    }
+    std::cout << "Loaded " << frames.size() << " frames from " << source << std::endl;
+
+    std::vector<cv::Point2f> labels;
+    if (!labelsFile.empty() && !loadLabels(labelsFile, frames.size(), labels)) {
+        return -1;
+    }
+
+    std::vector<SweepPoint> points;
+    if (randomPoints > 0) {
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<int> thresholdDist(30, 220);
+        std::uniform_int_distribution<int> minAreaDist(30, 600);
+        std::uniform_int_distribution<int> maxAreaDist(1000, 30000);
+        std::uniform_real_distribution<float> circularityDist(0.3f, 0.9f);
+        for (int i = 0; i < randomPoints; ++i) {
+            points.push_back({thresholdDist(rng), minAreaDist(rng), maxAreaDist(rng), circularityDist(rng)});
+        }
+    } else {
+        for (int threshold = 60; threshold <= 180; threshold += 20)
+            for (int minArea : {75, 150, 300})
+                for (int maxArea : {5000, 10000, 20000})
+                    for (float circularity : {0.4f, 0.5f, 0.6f, 0.7f})
+                        points.push_back({threshold, minArea, maxArea, circularity});
+    }
+    std::cout << "Evaluating " << points.size() << " parameter points on " << threadCount << " threads..." << std::endl;
+
+    // Parallelism comes from the sweep itself, so keep OpenCV single-threaded per call
+    cv::setNumThreads(1);
+
+    std::vector<SweepResult> results(points.size());
+    std::atomic<size_t> nextPoint(0);
+    std::atomic<size_t> donePoints(0);
+    auto worker = [&]() {
+        for (size_t i = nextPoint++; i < points.size(); i = nextPoint++) {
+            Config config = baseConfig;
+            config.PUCK_THRESHOLD = points[i].threshold;
+            config.PUCK_MIN_AREA = points[i].minArea;
+            config.PUCK_MAX_AREA = points[i].maxArea;
+            config.PUCK_MIN_CIRCULARITY = points[i].minCircularity;
+            ImageCapture detector(config);
+
+            SweepResult& result = results[i];
+            result.point = points[i];
+            result.detections.resize(frames.size());
+            for (int run = 0; run < TIMING_RUNS; ++run) {
+                auto start = std::chrono::high_resolution_clock::now();
+                for (size_t f = 0; f < frames.size(); ++f) {
+                    result.detections[f] = detector.detectPuck(frames[f]);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                double ms = std::chrono::duration<double, std::milli>(end - start).count() / frames.size();
+                result.msPerFrame = run == 0 ? ms : std::min(result.msPerFrame, ms);
+            }
+
+            size_t done = ++donePoints;
+            if (done % 10 == 0) std::cout << "  " << done << "/" << points.size() << " points done" << std::endl;
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; ++t) workers.emplace_back(worker);
+    for (auto& t : workers) t.join();
+
+    if (labels.empty()) {
+        const float maxStepPx = std::max(frames[0].cols, frames[0].rows) * 0.1f;  // generous per-frame motion limit
+        labels = buildConsensusLabels(results, frames.size(), maxStepPx);
+        std::cout << "No labels given, scoring against self-consistent consensus track" << std::endl;
+    }
+    for (auto& r : results) scoreResult(r, labels, tolerancePx);
+
+    std::vector<size_t> pareto;
+    for (size_t i = 0; i < results.size(); ++i) {
+        bool dominated = false;
+        for (size_t j = 0; j < results.size() && !dominated; ++j) {
+            if (j != i && dominates(results[j], results[i])) dominated = true;
+        }
+        if (!dominated) pareto.push_back(i);
+    }
+    std::sort(pareto.begin(), pareto.end(), [&](size_t a, size_t b) {
+        if (results[a].detectionRate != results[b].detectionRate) return results[a].detectionRate > results[b].detectionRate;
+        return results[a].falsePositiveRate < results[b].falsePositiveRate;
+    });
+
+    std::error_code ec;
+    std::filesystem::create_directories(outDir, ec);
+    if (ec) {
+        std::cerr << "Error: could not create directory '" << outDir << "': " << ec.message() << std::endl;
+        return -1;
+    }
+
+    std::ofstream csv(outDir + "/sweep.csv");
+    csv << "threshold,min_area,max_area,min_circularity,detection_rate,false_positives,false_positive_rate,ms_per_frame,pareto" << std::endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const SweepResult& r = results[i];
+        bool isPareto = std::find(pareto.begin(), pareto.end(), i) != pareto.end();
+        csv << r.point.threshold << "," << r.point.minArea << "," << r.point.maxArea << "," << r.point.minCircularity << ","
+            << r.detectionRate << "," << r.falsePositives << "," << r.falsePositiveRate << "," << r.msPerFrame << "," << (isPareto ? 1 : 0) << std::endl;
+    }
+
+    std::cout << "\n=== Pareto-best detection parameters ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (size_t k = 0; k < pareto.size() && k < MAX_PARETO_CONFIGS; ++k) {
+        const SweepResult& r = results[pareto[k]];
+        std::cout << "#" << k << "  thr=" << r.point.threshold << " area=[" << r.point.minArea << "," << r.point.maxArea << "]"
+                  << " circ=" << r.point.minCircularity << "  det=" << r.detectionRate * 100.0 << "%"
+                  << " fp=" << r.falsePositives << " cost=" << r.msPerFrame << " ms" << std::endl;
+
+        Config candidate = baseConfig;
+        candidate.PUCK_THRESHOLD = r.point.threshold;
+        candidate.PUCK_MIN_AREA = r.point.minArea;
+        candidate.PUCK_MAX_AREA = r.point.maxArea;
+        candidate.PUCK_MIN_CIRCULARITY = r.point.minCircularity;
+        std::ostringstream fname;
+        fname << outDir << "/config_pareto_" << std::setw(2) << std::setfill('0') << k << ".json";
+        candidate.saveToFile(fname.str());
+        std::cout << std::setfill(' ');
+    }
+    if (pareto.size() > MAX_PARETO_CONFIGS) {
+        std::cout << (pareto.size() - MAX_PARETO_CONFIGS) << " more Pareto points are marked in sweep.csv" << std::endl;
+    }
+    std::cout << "Results written to " << outDir << "/sweep.csv" << std::endl;
+    return 0;
+}
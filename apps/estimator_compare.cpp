@@ -0,0 +1,153 @@
+#include "trajectory.hpp"
+#include "config.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Kalman filter and RANSAC line fit side by side on the same simulated detections:
+// estimate accuracy against the true track, 100 ms look-ahead accuracy and update cost.
+
+struct Sample {
+    uint64_t timestamp;
+    cv::Point2f truePosition;
+    cv::Point2f trueVelocity;
+    cv::Point2f measured;
+    bool detected;
+};
+
+struct CompareResult {
+    double positionRms = 0.0;
+    double velocityRms = 0.0;
+    double velocityP95 = 0.0;
+    double lookaheadRms = 0.0;  // predictPosition 100 ms ahead vs the true position then
+    double usPerUpdate = 0.0;
+};
+
+// Puck gliding with wall bounces, random hits, missed detections and gross outliers
+// (a mallet or reflection picked up instead of the puck)
+static std::vector<Sample> simulate(const Config& config, size_t steps, double dt, double noiseMm, double outlierRate) {
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, noiseMm);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double r = config.PUCK_RADIUS_REAL;
+    const double lo[2] = {r, r};
+    const double hi[2] = {config.PHYSICAL_TABLE_WIDTH - r, config.PHYSICAL_TABLE_HEIGHT - r};
+    const double restitution[4] = {config.WALL_RESTITUTION_X_MIN, config.WALL_RESTITUTION_X_MAX,
+                                   config.WALL_RESTITUTION_Y_MIN, config.WALL_RESTITUTION_Y_MAX};
+
+    std::vector<Sample> samples(steps);
+    double s[4] = {config.PHYSICAL_TABLE_WIDTH / 2.0, config.PHYSICAL_TABLE_HEIGHT / 2.0, 1200.0, 700.0};
+    uint64_t timestamp = 1000000;
+    for (size_t i = 0; i < steps; ++i) {
+        if (uniform(rng) < 0.002) {
+            double angle = uniform(rng) * 2.0 * M_PI;
+            double speed = 300.0 + uniform(rng) * 2500.0;
+            s[2] = speed * std::cos(angle);
+            s[3] = speed * std::sin(angle);
+        }
+        double decay = std::exp(-config.GLIDE_DECAY * dt);
+        s[0] += s[2] * dt;
+        s[1] += s[3] * dt;
+        s[2] *= decay;
+        s[3] *= decay;
+        for (int axis = 0; axis < 2; ++axis) {
+            if (s[axis] < lo[axis]) { s[axis] = 2.0 * lo[axis] - s[axis]; s[axis + 2] *= -restitution[2 * axis]; }
+            if (s[axis] > hi[axis]) { s[axis] = 2.0 * hi[axis] - s[axis]; s[axis + 2] *= -restitution[2 * axis + 1]; }
+        }
+        timestamp += (uint64_t)(dt * 1e6);
+        Sample& sample = samples[i];
+        sample.timestamp = timestamp;
+        sample.truePosition = cv::Point2f(s[0], s[1]);
+        sample.trueVelocity = cv::Point2f(s[2], s[3]);
+        sample.detected = uniform(rng) > 0.03;
+        sample.measured = cv::Point2f(s[0] + noise(rng), s[1] + noise(rng));
+        if (uniform(rng) < outlierRate) {
+            double angle = uniform(rng) * 2.0 * M_PI;
+            double offset = 20.0 + uniform(rng) * 40.0;
+            sample.measured += cv::Point2f(offset * std::cos(angle), offset * std::sin(angle));
+        }
+    }
+    return samples;
+}
+
+static CompareResult run(const Config& config, TrajectoryEstimator estimator, const std::vector<Sample>& samples, double dt) {
+    TrajectoryPredictor predictor(config);
+    predictor.setEstimator(estimator);
+    const size_t lookahead = (size_t)std::lround(0.1 / dt);
+
+    CompareResult result;
+    std::vector<double> velocityErrors;
+    double positionSq = 0.0, velocitySq = 0.0, lookaheadSq = 0.0, updateUs = 0.0;
+    size_t scored = 0, lookaheadScored = 0, updates = 0;
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const Sample& s = samples[i];
+        if (!s.detected) continue;
+        auto start = std::chrono::high_resolution_clock::now();
+        predictor.addMeasurement({s.measured, s.timestamp});
+        auto end = std::chrono::high_resolution_clock::now();
+        updateUs += std::chrono::duration<double, std::micro>(end - start).count();
+        updates++;
+        if (i < 100) continue;  // let both estimators settle
+
+        cv::Point2f position = predictor.getPosition();
+        cv::Point2f velocity = predictor.getVelocity();
+        positionSq += std::pow(cv::norm(position - s.truePosition), 2);
+        double velocityError = cv::norm(velocity - s.trueVelocity);
+        velocitySq += velocityError * velocityError;
+        velocityErrors.push_back(velocityError);
+        scored++;
+        if (i + lookahead < samples.size()) {
+            const Sample& future = samples[i + lookahead];
+            lookaheadSq += std::pow(cv::norm(predictor.predictPosition(future.timestamp) - future.truePosition), 2);
+            lookaheadScored++;
+        }
+    }
+    if (scored > 0) {
+        result.positionRms = std::sqrt(positionSq / scored);
+        result.velocityRms = std::sqrt(velocitySq / scored);
+        std::nth_element(velocityErrors.begin(), velocityErrors.begin() + velocityErrors.size() * 95 / 100, velocityErrors.end());
+        result.velocityP95 = velocityErrors[velocityErrors.size() * 95 / 100];
+    }
+    if (lookaheadScored > 0) result.lookaheadRms = std::sqrt(lookaheadSq / lookaheadScored);
+    if (updates > 0) result.usPerUpdate = updateUs / updates;
+    return result;
+}
+
+static void printResult(const std::string& name, const CompareResult& r) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(2)
+              << "  pos " << r.positionRms << " mm"
+              << "  vel " << std::setprecision(1) << r.velocityRms << " mm/s (p95 " << r.velocityP95 << ")"
+              << "  +100ms " << std::setprecision(2) << r.lookaheadRms << " mm"
+              << "  " << std::setprecision(2) << r.usPerUpdate << " us/update" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t steps = 200000;  // ~14 minutes of play at 240 fps
+    double noiseMm = 1.0;
+    double outlierRate = 0.02;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--steps" && i + 1 < argc) steps = std::stoul(argv[++i]);
+        else if (arg == "--noise" && i + 1 < argc) noiseMm = std::stod(argv[++i]);
+        else if (arg == "--outliers" && i + 1 < argc) outlierRate = std::stod(argv[++i]);
+        else {
+            std::cout << "Usage: estimator_compare [--steps n] [--noise mm] [--outliers fraction]" << std::endl;
+            return -1;
+        }
+    }
+
+    Config config;
+    config.loadFromFile();
+    const double dt = 1.0 / 240.0;
+    std::cout << "Simulating " << steps << " frames, " << noiseMm << " mm noise, " << outlierRate * 100.0 << "% outliers" << std::endl;
+    std::vector<Sample> samples = simulate(config, steps, dt, noiseMm, outlierRate);
+
+    printResult("kalman", run(config, ESTIMATOR_KALMAN, samples, dt));
+    printResult("line fit", run(config, ESTIMATOR_LINE_FIT, samples, dt));
+    return 0;
+}
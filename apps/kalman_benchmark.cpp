@@ -0,0 +1,149 @@
+#include "kalman.hpp"
+#include "config.hpp"
+#include <eigen3/Eigen/Eigenvalues>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Double vs single precision puck filter on the same simulated measurements: accuracy
+// against the true track, covariance health over a long run without resets, and cost.
+
+struct Sample {
+    Eigen::Vector4d truth;    // x, y, vx, vy
+    Eigen::Vector2d measured;
+};
+
+struct RunResult {
+    double positionRms = 0.0;
+    double velocityRms = 0.0;
+    double maxAsymmetry = 0.0;      // largest |P - P^T| entry
+    double minEigenvalue = 1e300;   // smallest covariance eigenvalue seen
+    double nsPerStep = 0.0;
+    std::vector<Eigen::Vector4d> states;  // every 1000th state, for the float/double comparison
+};
+
+// Puck gliding on the table with wall bounces and a rare mallet hit (about every 40 s)
+static std::vector<Sample> simulate(const Config& config, size_t steps, double dt, double noiseMm) {
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, noiseMm);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double r = config.PUCK_RADIUS_REAL;
+    const double lo[2] = {r, r};
+    const double hi[2] = {config.PHYSICAL_TABLE_WIDTH - r, config.PHYSICAL_TABLE_HEIGHT - r};
+
+    std::vector<Sample> samples(steps);
+    Eigen::Vector4d s(config.PHYSICAL_TABLE_WIDTH / 2.0, config.PHYSICAL_TABLE_HEIGHT / 2.0, 1200.0, 700.0);
+    for (size_t i = 0; i < steps; ++i) {
+        if (uniform(rng) < 1e-4) {
+            double angle = uniform(rng) * 2.0 * M_PI;
+            double speed = 300.0 + uniform(rng) * 2500.0;
+            s(2) = speed * std::cos(angle);
+            s(3) = speed * std::sin(angle);
+        }
+        s.head<2>() += s.tail<2>() * dt;
+        for (int axis = 0; axis < 2; ++axis) {
+            if (s(axis) < lo[axis]) { s(axis) = 2.0 * lo[axis] - s(axis); s(axis + 2) = -s(axis + 2); }
+            if (s(axis) > hi[axis]) { s(axis) = 2.0 * hi[axis] - s(axis); s(axis + 2) = -s(axis + 2); }
+        }
+        samples[i].truth = s;
+        samples[i].measured = s.head<2>() + Eigen::Vector2d(noise(rng), noise(rng));
+    }
+    return samples;
+}
+
+template <typename Filter>
+static RunResult run(const Config& config, const std::vector<Sample>& samples, double dt) {
+    typedef typename Filter::ScalarType Scalar;
+    const double r = config.PUCK_RADIUS_REAL;
+    const double lo[2] = {r, r};
+    const double hi[2] = {config.PHYSICAL_TABLE_WIDTH - r, config.PHYSICAL_TABLE_HEIGHT - r};
+
+    Filter filter;
+    typename Filter::StateVector initial;
+    initial << Scalar(samples[0].measured(0)), Scalar(samples[0].measured(1)), Scalar(0), Scalar(0);
+    filter.setState(initial);
+    typename Filter::StateMatrix P = filter.getCovariance();
+    P(2, 2) = P(3, 3) = Scalar(3000.0 * 3000.0);
+    filter.setCovariance(P);
+    filter.setTransition(dt);
+
+    RunResult result;
+    double positionSq = 0.0, velocitySq = 0.0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 1; i < samples.size(); ++i) {
+        filter.predict();
+        const typename Filter::StateVector& x = filter.getState();
+        for (int axis = 0; axis < 2; ++axis) {
+            if (x(axis) < lo[axis]) filter.reflect(axis, lo[axis]);
+            else if (x(axis) > hi[axis]) filter.reflect(axis, hi[axis]);
+        }
+        filter.update(typename Filter::MeasVector(Scalar(samples[i].measured(0)), Scalar(samples[i].measured(1))));
+
+        Eigen::Vector4d state = filter.getState().template cast<double>();
+        Eigen::Vector4d error = state - samples[i].truth;
+        positionSq += error.head<2>().squaredNorm();
+        velocitySq += error.tail<2>().squaredNorm();
+        if (i % 1000 == 0) {
+            Eigen::Matrix4d cov = filter.getCovariance().template cast<double>();
+            result.maxAsymmetry = std::max(result.maxAsymmetry, (cov - cov.transpose()).cwiseAbs().maxCoeff());
+            Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> eigen(0.5 * (cov + cov.transpose()));
+            result.minEigenvalue = std::min(result.minEigenvalue, eigen.eigenvalues().minCoeff());
+            result.states.push_back(state);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    size_t steps = samples.size() - 1;
+    result.nsPerStep = std::chrono::duration<double, std::nano>(end - start).count() / steps;
+    result.positionRms = std::sqrt(positionSq / steps);
+    result.velocityRms = std::sqrt(velocitySq / steps);
+    return result;
+}
+
+static void printResult(const std::string& name, const RunResult& r, size_t filterBytes) {
+    std::cout << std::left << std::setw(8) << name << std::right << std::fixed
+              << "  pos " << std::setprecision(3) << r.positionRms << " mm"
+              << "  vel " << std::setprecision(2) << r.velocityRms << " mm/s"
+              << "  asym " << std::scientific << std::setprecision(1) << r.maxAsymmetry
+              << "  min eig " << r.minEigenvalue << std::fixed
+              << "  " << std::setprecision(1) << r.nsPerStep << " ns/step"
+              << "  " << filterBytes << " bytes" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t steps = 2000000;  // ~2.3 hours of play at 240 fps
+    double noiseMm = 1.0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--steps" && i + 1 < argc) steps = std::stoul(argv[++i]);
+        else if (arg == "--noise" && i + 1 < argc) noiseMm = std::stod(argv[++i]);
+        else {
+            std::cout << "Usage: kalman_benchmark [--steps n] [--noise mm]" << std::endl;
+            return -1;
+        }
+    }
+
+    Config config;
+    config.loadFromFile();
+    const double dt = 1.0 / 240.0;
+    std::cout << "Simulating " << steps << " frames (" << steps * dt / 60.0 << " min), " << noiseMm << " mm noise, no resets" << std::endl;
+    std::vector<Sample> samples = simulate(config, steps, dt, noiseMm);
+
+    RunResult resultDouble = run<KalmanFilterT<4, 2, double>>(config, samples, dt);
+    RunResult resultFloat = run<KalmanFilterT<4, 2, float>>(config, samples, dt);
+    printResult("double", resultDouble, sizeof(KalmanFilterT<4, 2, double>));
+    printResult("float", resultFloat, sizeof(KalmanFilterT<4, 2, float>));
+
+    double maxPosition = 0.0, maxVelocity = 0.0;
+    for (size_t i = 0; i < resultDouble.states.size(); ++i) {
+        Eigen::Vector4d d = resultFloat.states[i] - resultDouble.states[i];
+        maxPosition = std::max(maxPosition, d.head<2>().norm());
+        maxVelocity = std::max(maxVelocity, d.tail<2>().norm());
+    }
+    std::cout << "float vs double: max state difference " << std::setprecision(4) << maxPosition << " mm, "
+              << maxVelocity << " mm/s" << std::endl;
+    return 0;
+}
@@ -2,6 +2,12 @@
 #include "trajectory.hpp"
 #include "movement.hpp"
 #include "game_controller.hpp"
+#include "mallet.hpp"
+#include "idle_monitor.hpp"
+#include "session_recorder.hpp"
+#include "latency.hpp"
+#include "physics_estimator.hpp"
+#include "prediction_service.hpp"
 #include <opencv2/opencv.hpp>
 #include <chrono>
 #include <vector>
@@ -11,6 +17,26 @@
 #include <iomanip>
 #include <filesystem>
 #include <ctime>
+#include <csignal>
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void handleStopSignal(int) {
+    stopRequested = 1;
+}
+
+// Opponent's half of the table in image pixels: deeper than half the table from our goal line
+static cv::Rect opponentHalf(const AxisMap& zoneFrame, const Config& config, ImageCapture& capture, int imageWidth, int imageHeight) {
+    AxisMap tableFromZone = zoneFrame.inverse();
+    float lateral = zoneFrame.axis[0] == 0 ? config.PHYSICAL_TABLE_WIDTH : config.PHYSICAL_TABLE_HEIGHT;
+    float depth = zoneFrame.axis[1] == 0 ? config.PHYSICAL_TABLE_WIDTH : config.PHYSICAL_TABLE_HEIGHT;
+    cv::Point2f a = capture.TableToImageCoordinates(tableFromZone.map(cv::Point2f(0, depth / 2)), imageWidth, imageHeight);
+    cv::Point2f b = capture.TableToImageCoordinates(tableFromZone.map(cv::Point2f(lateral, depth)), imageWidth, imageHeight);
+    int x0 = cvRound(std::min(a.x, b.x)), y0 = cvRound(std::min(a.y, b.y));
+    int x1 = cvRound(std::max(a.x, b.x)), y1 = cvRound(std::max(a.y, b.y));
+    cv::Rect region(x0, y0, x1 - x0, y1 - y0);
+    return region & cv::Rect(0, 0, imageWidth, imageHeight);
+}
 
 int main() {
     Config config;
@@ -26,16 +52,26 @@ int main() {
     TrajectoryPredictor predictor(config);
     MovementController mover(config);
     GameController gameController(config);
+    MalletTracker malletTracker(config);
+    IdleMonitor idleMonitor(config);
+    SessionRecorder sessionRecorder(config);
+    LatencyTracker latency(config);
+    PhysicsEstimator physics(config);
+    PredictionService predictionService(config, predictor, mover);
+    predictionService.start();
+    SessionFrameRecord sessionRecord;
+    sessionRecord.detections.reserve(2);
+
+    // Stop cleanly on Ctrl+C so the session file and robot get closed properly
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
 
 
     bool running = true;
 
-    // Last valid puck measurement (in table coordinates) used to detect jumps
-    cv::Point2f lastPuckTablePos(-1, -1);
-    uint64_t lastPuckTimeUs = 0;
-    bool lastPuckValid = false;
-    const double MAX_PUCK_SPEED_MM_S = 9999.0; // threshold to ignore samples (mm/s)
-    const double MIN_PUCK_SPEED_MM_S = 30.0; // if slower than this, consider it standing still (mm/s)
+    // Hits, bounces and stops are found by the predictor; each one is logged once
+    uint64_t lastEventTimeUs = 0;
+    static const char* eventNames[] = {"none", "bounce", "hit", "stop"};
     int debugImageIndex = 0; // sequential index for all debug images
     uint64_t lastMoveTimeUs = 0; // timestamp of last move command
     const uint64_t DEBUG_RECORD_DURATION_US = 1000000; // 1 second in microseconds
@@ -47,13 +83,23 @@ int main() {
     auto lastTime = std::chrono::high_resolution_clock::now();
     double fps = 0.0;
 
-    while (running) {
+    while (running && !stopRequested) {
+        // Idle: drain the camera without decoding, and only look at every k-th frame
+        if (idleMonitor.isIdle() && !idleMonitor.shouldCheckFrame()) {
+            capture.grabFrame();
+            continue;
+        }
+
         cv::Mat frame = capture.captureImage();
         if (frame.empty()) {
             std::cerr << "Failed to capture frame." << std::endl;
             continue;
         }
 
+        if (idleMonitor.isIdle() && !idleMonitor.detectMotion(frame, capture.getFrameMetadata().timestampUs)) {
+            continue;
+        }
+
         // FPS calculation
         frameCount++;
         auto currentTime_FPS = std::chrono::high_resolution_clock::now();
@@ -69,10 +115,42 @@ int main() {
 
         cv::Point2f puckCenter = capture.detectPuck(gray);
         bool puckDetected = (puckCenter.x >= 0 && puckCenter.y >= 0);
+        latency.beginFrame(capture.getFrameMetadata().timestampUs);
+        latency.mark(STAGE_DETECT);
+
+        if (config.RECORD_SESSION && !sessionRecorder.isOpen()) {
+            std::filesystem::create_directories("sessions");
+            std::time_t startTime = std::time(nullptr);
+            std::tm startTm = {};
+#if defined(_WIN32) || defined(_WIN64)
+            localtime_s(&startTm, &startTime);
+#else
+            localtime_r(&startTime, &startTm);
+#endif
+            char sessionName[64];
+            strftime(sessionName, sizeof(sessionName), "sessions/session_%Y%m%d_%H%M%S.ahs", &startTm);
+            sessionRecorder.open(sessionName, gray);
+        }
+        sessionRecord.detections.clear();
+        sessionRecord.commandSent = false;
+        sessionRecord.timestampUs = capture.getFrameMetadata().timestampUs;
 
         double currentTime = cv::getTickCount() / cv::getTickFrequency();
         uint64_t currentTimeUs = (uint64_t)(currentTime * 1000000.0);
 
+        idleMonitor.observePuck(capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight()), puckDetected, currentTimeUs);
+
+        if (config.ENABLE_MALLET_TRACKING) {
+            cv::Point2f malletCenter = capture.detectMallet(gray, puckCenter, opponentHalf(predictor.getZoneFrame(), config, capture, gray.cols, gray.rows));
+            if (malletCenter.x >= 0 && malletCenter.y >= 0) {
+                cv::Point2f malletTablePos = capture.imageToTableCoordinates(malletCenter, capture.getCroppedWidth(), capture.getCroppedHeight());
+                malletTracker.addMeasurement(malletTablePos, capture.getFrameMetadata().rowTimestampUs(malletCenter.y));
+                sessionRecord.detections.push_back({SESSION_DETECTION_MALLET, capture.getFrameMetadata().rowTimestampUs(malletCenter.y), malletCenter, malletTablePos, cv::Rect()});
+            } else {
+                malletTracker.markMissing();
+            }
+        }
+
         bool moveCommandSent = false; // Track if robot move was sent this frame
 
         cv::Point2f predictedEntryTable;
@@ -80,40 +158,28 @@ int main() {
         predictedEntryTable.y = -1.0f;
         if (puckDetected) {
             cv::Point2f currentTablePos = capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight());
-
-            bool acceptSample = true;
-            double computedSpeed = 0.0;
-            if (lastPuckValid) {
-                double dt = (currentTimeUs - lastPuckTimeUs) / 1000000.0; // seconds
-                if (dt > 0) {
-                    double dx = currentTablePos.x - lastPuckTablePos.x;
-                    double dy = currentTablePos.y - lastPuckTablePos.y;
-                    computedSpeed = std::hypot(dx, dy) / dt; // mm/s
-                    if (computedSpeed > MAX_PUCK_SPEED_MM_S) {
-                        acceptSample = false;
-                        // std::cout << "Skipping sample: high speed " << computedSpeed << " mm/s" << std::endl;
-                    } else if (computedSpeed < MIN_PUCK_SPEED_MM_S) {
-                        // Puck nearly still -> reset and reinitialize with zero velocity immediately
-                        predictor.reset();
-                        PuckPosition puckPos = {currentTablePos, currentTimeUs};
-                        predictor.addMeasurement(puckPos);
-                        lastPuckTablePos = currentTablePos;
-                        lastPuckTimeUs = currentTimeUs;
-                        lastPuckValid = true;
-                        acceptSample = false;
-                    }
-                }
+            // Timestamp the detection with the exposure time of the row it was imaged on
+            uint64_t puckTimeUs = capture.getFrameMetadata().rowTimestampUs(puckCenter.y);
+            sessionRecord.detections.push_back({SESSION_DETECTION_PUCK, puckTimeUs, puckCenter, currentTablePos, cv::Rect()});
+
+            // Outliers are gated inside the predictor on the innovation's Mahalanobis distance;
+            // hits and stops restart its velocity there instead of resetting the track here
+            PuckPosition puckPos = {currentTablePos, puckTimeUs};
+            if (config.PHYSICS_ESTIMATION_ENABLED) physics.addMeasurement(puckPos);
+            predictor.addMeasurement(puckPos);
+            if (predictor.getGateStatistics().lastResult == GATE_REINITIALIZED) {
+                std::cout << "Track re-initialized after " << config.GATE_MAX_CONSECUTIVE_REJECTS << " gated measurements" << std::endl;
             }
-
-            PuckPosition puckPos = {currentTablePos, currentTimeUs};
-            if (acceptSample) {
-                predictor.addMeasurement(puckPos);
-                lastPuckTablePos = currentTablePos;
-                lastPuckTimeUs = currentTimeUs;
-                lastPuckValid = true;
+            const TrajectoryEvent& event = predictor.getEventStatistics().last;
+            if (event.type != EVENT_NONE && event.timestamp != lastEventTimeUs) {
+                lastEventTimeUs = event.timestamp;
+                std::cout << "Puck " << eventNames[event.type] << " at X: " << event.position.x << " mm, Y: " << event.position.y
+                          << " mm, velocity " << event.velocityBefore.x << ", " << event.velocityBefore.y << " -> "
+                          << event.velocityAfter.x << ", " << event.velocityAfter.y << " mm/s" << std::endl;
             }
 
             predictedEntryTable = predictor.predictEntryToDefenseZone(currentTimeUs);
+            latency.mark(STAGE_PREDICT);
 
             cv::Point2f predictedShort = predictor.predictPosition(currentTimeUs + 100000); // +100ms
             double velocityConfidence = predictor.getVelocityConfidence();
@@ -133,6 +199,12 @@ int main() {
         }
 
 
+        // With the prediction service running it is the only sender of moves; the ones it sent
+        // since the last frame are recorded and rendered here like the camera loop's own
+        PredictionServiceCommand serviceCommand;
+        bool serviceMoved = predictionService.takeCommand(serviceCommand);
+        if (serviceMoved) latency.record(STAGE_SEND, serviceCommand.sendLatencyUs);
+
         if (predictedEntryTable.x >= 0 && predictedEntryTable.y >= 0) {
             
             // Check direction: if puck is moving AWAY from defense zone, skip (we already hit it to opponent side)
@@ -140,84 +212,72 @@ int main() {
             cv::Point2f predictedShortCheck = predictor.predictPosition(currentTimeUs + 100000);
             if (predictedShortCheck.x >= 0 && predictedShortCheck.y >= 0 && puckDetected) {
                 cv::Point2f currentTablePos = capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight());
-                double vx = (predictedShortCheck.x - currentTablePos.x) * 10.0; // velocity estimate mm/s
-                double vy = (predictedShortCheck.y - currentTablePos.y) * 10.0;
-
-                switch (config.WHERE_DEFENSE_ZONE) {
-                case 0: // Left zone: check if vx > 0 (moving away from left)
-                    if (vx > 0) movingTowardZone = false;
-                    break;
-                case 1: // Right zone: check if vx < 0 (moving away from right)
-                    if (vx < 0) movingTowardZone = false;
-                    break;
-                case 2: // Bottom zone: check if vy < 0 (moving away from bottom)
-                    if (vy < 0) movingTowardZone = false;
-                    break;
-                case 3: // Top zone: check if vy > 0 (moving away from top)
-                    if (vy > 0) movingTowardZone = false;
-                    break;
-                default:
-                    break;
-                }
+                cv::Point2f velocity = (predictedShortCheck - currentTablePos) * 10.0f; // velocity estimate mm/s
+                // Moving away when the depth from the goal line grows
+                if (predictor.getZoneFrame().mapVector(velocity).y > 0) movingTowardZone = false;
             }
 
-            if (!movingTowardZone) {
+            if (!movingTowardZone && !predictionService.isRunning()) {
                 //std::cout << "Skipping: puck moving away from defense zone (already hit to opponent side)" << std::endl;
             } else {
 
-            // Move robot
+            // Move robot: commit to the mean entry when its spread is tight, hedge toward the goal centre otherwise
+            // (the service does this for its own snapshot)
             cv::Point2f robotPosInTable(predictedEntryTable.x, predictedEntryTable.y);
+            EntryDistribution entryDistribution;
+            if (!predictionService.isRunning()) {
+                entryDistribution = predictor.predictEntryDistribution();
+                if (entryDistribution.valid) robotPosInTable = predictor.hedgeEntry(entryDistribution);
+            }
             cv::Point2f robotPos = mover.TableToRobotCoordinates(robotPosInTable);
 
-            // Check if puck has sufficient speed before moving robot
-            cv::Point2f predictedShortForSpeed = predictor.predictPosition(currentTimeUs + 100000);
-            double speedForRobot = 0.0;
-            if (predictedShortForSpeed.x >= 0 && predictedShortForSpeed.y >= 0 && puckDetected) {
-                cv::Point2f currentTablePos = capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight());
-                double vxSpeed = (predictedShortForSpeed.x - currentTablePos.x) * 10.0;
-                double vySpeed = (predictedShortForSpeed.y - currentTablePos.y) * 10.0;
-                speedForRobot = std::hypot(vxSpeed, vySpeed);
+            // Judge the puck where it will be when the robot can actually act on this command:
+            // the rest of the pipeline up to sendto plus the robot's actuation delay
+            uint64_t actionTimeUs = latency.actionTimestamp();
+            cv::Point2f actionTablePos = predictor.predictPosition(actionTimeUs);
+            if (actionTablePos.x < 0 || actionTablePos.y < 0) {
+                actionTablePos = capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight());
             }
 
-            const double MIN_SPEED_FOR_ROBOT_MM_S = 100.0;
-            const double DEFENSE_ZONE_BUFFER_MM = 100.0; // 10cm buffer
+            // Check if puck has sufficient speed before moving robot
+            cv::Point2f actionVelocity = predictor.predictVelocity(actionTimeUs);
+            double speedForRobot = std::hypot(actionVelocity.x, actionVelocity.y);
+
+            const double MIN_SPEED_FOR_ROBOT_MM_S = PredictionService::MIN_SPEED_FOR_ROBOT_MM_S;
+            const double DEFENSE_ZONE_BUFFER_MM = PredictionService::DEFENSE_ZONE_BUFFER_MM; // 10cm buffer
             
-            cv::Point2f currentTablePos = capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight());
-            bool puckTooCloseToZone = predictor.isInDefenseZone(currentTablePos);
+            bool puckTooCloseToZone = predictor.isInDefenseZone(actionTablePos);
             
-            // Check if within 10cm buffer of zone boundary
-            if (!puckTooCloseToZone) {
-                switch (config.WHERE_DEFENSE_ZONE) {
-                case 0: // Left zone
-                    if (currentTablePos.x < config.DEFENSE_ZONE_WIDTH + DEFENSE_ZONE_BUFFER_MM) {
-                        puckTooCloseToZone = true;
-                    }
-                    break;
-                case 1: // Right zone
-                    if (currentTablePos.x > config.PHYSICAL_TABLE_WIDTH - config.DEFENSE_ZONE_WIDTH - DEFENSE_ZONE_BUFFER_MM) {
-                        puckTooCloseToZone = true;
-                    }
-                    break;
-                case 2: // Top zone
-                    if (currentTablePos.y < config.DEFENSE_ZONE_HEIGHT + DEFENSE_ZONE_BUFFER_MM) {
-                        puckTooCloseToZone = true;
-                    }
-                    break;
-                case 3: // Bottom zone
-                    if (currentTablePos.y > config.PHYSICAL_TABLE_HEIGHT - config.DEFENSE_ZONE_HEIGHT - DEFENSE_ZONE_BUFFER_MM) {
-                        puckTooCloseToZone = true;
-                    }
-                    break;
-                }
+            // Check if within 10cm buffer of zone boundary (depth from the goal line)
+            if (!puckTooCloseToZone && predictor.getZoneFrame().map(actionTablePos).y < config.DEFENSE_ZONE_HEIGHT + DEFENSE_ZONE_BUFFER_MM) {
+                puckTooCloseToZone = true;
             }
             
-            if (speedForRobot < MIN_SPEED_FOR_ROBOT_MM_S) {
+            bool moveSent = false;
+            if (predictionService.isRunning()) {
+                // Sent by the service with the same checks, judged at its own action time
+                if (serviceMoved && !serviceCommand.prePosition) {
+                    robotPosInTable = serviceCommand.tableTarget;
+                    robotPos = serviceCommand.robotTarget;
+                    serviceMoved = false;
+                    moveSent = true;
+                }
+            } else if (speedForRobot < MIN_SPEED_FOR_ROBOT_MM_S) {
                 //std::cout << "Skipping: puck speed too low (" << speedForRobot << " mm/s < " << MIN_SPEED_FOR_ROBOT_MM_S << " mm/s)" << std::endl;
             } else if (puckTooCloseToZone) {
                 //std::cout << "Skipping: puck already in or near defense zone (10cm buffer)" << std::endl;
-            } else if(mover.moveTo(robotPos)) {
+            } else if (mover.moveTo(robotPos)) {
+                latency.mark(STAGE_SEND);
+                moveSent = true;
+            } else {
+                std::cout << "Point too close to last position" << std::endl;
+            }
+
+            if (moveSent) {
                 moveCommandSent = true;
                 lastMoveTimeUs = currentTimeUs;
+                sessionRecord.commandSent = true;
+                sessionRecord.commandTarget = robotPos;
                 // Save frame immediately when move command is sent
                 std::filesystem::create_directories("debug_all_frames");
                 cv::Mat moveFrame = frame.clone();
@@ -248,25 +308,19 @@ int main() {
                 debugImageIndex++;
 
                 std::cout << "Camera coordinates entry: X: " << predictedEntryTable.x << " mm , Y: " << predictedEntryTable.y << " mm" << std::endl;
+                if (predictionService.isRunning()) {
+                    std::cout << "Service target X: " << robotPosInTable.x << " mm, Y: " << robotPosInTable.y << " mm, held " << serviceCommand.holdUs / 1000.0 << " ms" << std::endl;
+                } else if (entryDistribution.valid) {
+                    std::cout << "Entry spread: " << entryDistribution.lateralStd << " mm along goal line, " << entryDistribution.timeStdS * 1000.0 << " ms, hedged target X: " << robotPosInTable.x << " mm, Y: " << robotPosInTable.y << " mm" << std::endl;
+                }
                 std::cout << "Moving robot to: X: " << robotPos.x << " mm, Y: " << robotPos.y << " mm" << std::endl;
+                latency.print(std::cout);
 
 
 
-                // Estimate predicted entry time by probing predictor over a short horizon
-                uint64_t predictedEntryTimeUs = 0;
-                const uint64_t maxLookaheadUs = 2000000; // 2 seconds
-                const uint64_t stepUs = 10000; // 10 ms
-                for (uint64_t t = currentTimeUs; t <= currentTimeUs + maxLookaheadUs; t += stepUs) {
-                    cv::Point2f p = predictor.predictPosition(t);
-                    if (p.x < 0 || p.y < 0) continue;
-                    if (predictor.isInDefenseZone(p)) {
-                        predictedEntryTimeUs = t;
-                        break;
-                    }
-                }
-
-                double timeUntilMs = -1.0;
-                if (predictedEntryTimeUs > 0) timeUntilMs = (predictedEntryTimeUs - currentTimeUs) / 1000.0;
+                // Predicted entry time, solved analytically from the filter state
+                EntryPrediction entry = predictor.predictEntry();
+                uint64_t predictedEntryTimeUs = entry.valid ? entry.timestamp : 0;
 
                 // Render debug image with predictions
                 cv::Point2f predictedShort = predictor.predictPosition(currentTimeUs + 100000); // +100ms
@@ -281,22 +335,65 @@ int main() {
                     velocityConfidence,
                     fps,
                     currentTimeUs,
+                    predictedEntryTimeUs,
                     debugImageIndex,
                     capture,
-                    predictor
+                    predictor.getSnapshot()
                 };
                 gameController.renderDebugImage(debugParams);
-                // Reset predictor after hit to avoid stale velocity estimates
-                predictor.reset();
-                lastPuckValid = false;
-            } else {
-                std::cout << "Point too close to last position" << std::endl;
             }
             }
+        } else if (config.ENABLE_MALLET_TRACKING && puckDetected && predictor.isInitialized() && malletTracker.isTracking()) {
+            // No entry yet: if the opponent is about to hit the puck, pre-position for the outgoing shot
+            cv::Point2f puckNow = predictor.predictPosition(currentTimeUs);
+            ContactPrediction contact = malletTracker.predictContact(puckNow, predictor.getVelocity(), currentTimeUs);
+            if (contact.valid) {
+                cv::Point2f anticipatedEntry = predictor.predictEntryFromState(contact.puckAtContact, contact.outgoingVelocity);
+                if (anticipatedEntry.x >= 0 && anticipatedEntry.y >= 0) {
+                    cv::Point2f robotPos = mover.TableToRobotCoordinates(anticipatedEntry);
+                    if (predictionService.isRunning()) {
+                        predictionService.requestPrePosition(anticipatedEntry);
+                    } else if (mover.moveTo(robotPos)) {
+                        lastMoveTimeUs = currentTimeUs;
+                        sessionRecord.commandSent = true;
+                        sessionRecord.commandTarget = robotPos;
+                        std::cout << "Pre-positioning for mallet hit in " << contact.timeToContact * 1000.0 << " ms, entry X: " << anticipatedEntry.x << " mm, Y: " << anticipatedEntry.y << " mm" << std::endl;
+                    }
+                }
+            }
+        }
+
+        if (serviceMoved) {
+            // Pre-positioning move, or an entry the predictor has dropped since it was sent
+            moveCommandSent = true;
+            lastMoveTimeUs = currentTimeUs;
+            sessionRecord.commandSent = true;
+            sessionRecord.commandTarget = serviceCommand.robotTarget;
+            std::cout << (serviceCommand.prePosition ? "Pre-positioning" : "Prediction service") << " moved robot to: X: " << serviceCommand.robotTarget.x
+                      << " mm, Y: " << serviceCommand.robotTarget.y << " mm" << std::endl;
         }
 
-        // Debug: save frame for 1 second after move command (every 50ms)
-        if (lastMoveTimeUs > 0 && (currentTimeUs - lastMoveTimeUs) < DEBUG_RECORD_DURATION_US) {
+        idleMonitor.completeWake((uint64_t)(cv::getTickCount() / cv::getTickFrequency() * 1000000.0));
+
+        if (sessionRecorder.isOpen()) {
+            sessionRecord.filterValid = predictor.isInitialized();
+            if (sessionRecord.filterValid) {
+                cv::Point2f pos = predictor.getPosition();
+                cv::Point2f vel = predictor.getVelocity();
+                const KalmanFilter::StateMatrix& P = predictor.getCovariance();
+                sessionRecord.filterState[0] = pos.x;
+                sessionRecord.filterState[1] = pos.y;
+                sessionRecord.filterState[2] = vel.x;
+                sessionRecord.filterState[3] = vel.y;
+                for (int r = 0; r < 4; ++r) {
+                    for (int c = 0; c < 4; ++c) sessionRecord.filterCovariance[r * 4 + c] = P(r, c);
+                }
+            }
+            sessionRecorder.recordFrame(gray, sessionRecord);
+        }
+
+        // Debug: save frame for 1 second after move command (every 50ms), the session file already has every frame
+        if (!sessionRecorder.isOpen() && lastMoveTimeUs > 0 && (currentTimeUs - lastMoveTimeUs) < DEBUG_RECORD_DURATION_US) {
             if ((currentTimeUs - lastSavedFrameTimeUs) >= SAMPLE_INTERVAL_US) {
                 lastSavedFrameTimeUs = currentTimeUs;
                 
@@ -342,7 +439,19 @@ int main() {
         }
     }
 
+    sessionRecorder.close();
+    if (predictionService.isRunning()) {
+        predictionService.stop();
+        PredictionServiceStatistics serviceStats = predictionService.getStatistics();
+        std::cout << "Prediction service: " << serviceStats.ticks << " ticks, " << serviceStats.commands << " moves, "
+                  << serviceStats.overruns << " overruns, worst lateness " << serviceStats.maxLatenessUs << " us, longest hold "
+                  << serviceStats.maxHoldUs / 1000.0 << " ms" << std::endl;
+    }
     mover.stop();
+    if (config.PHYSICS_ESTIMATION_ENABLED && physics.saveEstimates("physics_estimate.json")) {
+        physics.print(std::cout);
+        std::cout << "Saved identified table physics to physics_estimate.json; copy the values into config.json to use them" << std::endl;
+    }
     std::cout << "Stopped." << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include "session_recorder.hpp"
+#include "smoother.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Offline identification of the Kalman filter noise (KALMAN_POSITION_NOISE,
+// KALMAN_VELOCITY_NOISE, KALMAN_MEASUREMENT_NOISE) from recorded sessions. Covariance
+// matching on the second differences of the detections gives the start values, which
+// expectation-maximization then refines: the E-step runs the RTS smoother with the current noise, the
+// M-step sets the noise to the expected measurement residuals and process increments of the
+// smoothed tracks. Steps that jump far beyond the process noise (hits, missed bounces) are
+// left out of the process noise, the filter's gate handles those live.
+
+struct NoiseStatistics {
+    double positionSum = 0.0;     // process increment variance per step, mean of x and y
+    double velocitySum = 0.0;
+    size_t steps = 0;
+    double measurementSum = 0.0;  // measurement residual variance, mean of x and y
+    size_t measurements = 0;
+    size_t maneuvers = 0;         // steps left out of the process noise
+
+    void add(const NoiseStatistics& other) {
+        positionSum += other.positionSum;
+        velocitySum += other.velocitySum;
+        steps += other.steps;
+        measurementSum += other.measurementSum;
+        measurements += other.measurements;
+        maneuvers += other.maneuvers;
+    }
+};
+
+static void printUsage() {
+    std::cout << "Usage: noise_identification <session.ahs|dir>... [options]" << std::endl;
+    std::cout << "  --cycles <n>       Maximum accelerated EM cycles, three EM steps each (default 10)" << std::endl;
+    std::cout << "  --threads <n>      Worker threads (default: all cores)" << std::endl;
+    std::cout << "  --config <file>    Config read and updated with the result (default config.json)" << std::endl;
+    std::cout << "  --dry-run          Print the result without writing the config" << std::endl;
+}
+
+static bool loadSession(const std::string& filename, std::vector<PuckPosition>& measurements) {
+    SessionReader reader;
+    if (!reader.open(filename)) return false;
+    SessionFrameRecord record;
+    cv::Mat frame;
+    while (reader.next(record, frame)) {
+        for (const SessionDetection& d : record.detections) {
+            if (d.kind != SESSION_DETECTION_PUCK) continue;
+            measurements.push_back({d.table, d.timestampUs});
+            break;  // the live loop only tracks one puck per frame
+        }
+    }
+    return !measurements.empty();
+}
+
+static const double MIN_VARIANCE = 1e-6;
+static const double MANEUVER_CHI2 = 18.47;  // 99.9% of chi-square(4): larger process increments are maneuvers
+// The smoother rejects detections beyond 99.9% of chi-square(2) instead of GATE_REJECT_CHI2,
+// so a hit restarts the track after GATE_MAX_CONSECUTIVE_REJECTS detections instead of
+// bending the smoothed path around it
+static const double IDENTIFICATION_GATE_CHI2 = 13.82;
+static const double MAX_EXTRAPOLATION = 50.0;  // bound on the SQUAREM step length
+
+// Second differences of detections one frame apart, per axis. A gap or an irregular frame
+// interval ends a run; runs are separated by NaN.
+static void collectSecondDifferences(const std::vector<PuckPosition>& measurements, double frameUs, std::vector<double>& values) {
+    for (int axis = 0; axis < 2; ++axis) {
+        int run = 0;  // regular frame intervals ending at k
+        for (size_t k = 1; k < measurements.size(); ++k) {
+            double interval = (double)(int64_t)(measurements[k].timestamp - measurements[k - 1].timestamp);
+            run = std::abs(interval - frameUs) < 0.2 * frameUs ? run + 1 : 0;
+            if (run == 0 && !values.empty() && !std::isnan(values.back())) values.push_back(NAN);
+            if (run < 2) continue;
+            const cv::Point2f& a = measurements[k - 2].position;
+            const cv::Point2f& b = measurements[k - 1].position;
+            const cv::Point2f& c = measurements[k].position;
+            values.push_back(axis == 0 ? c.x - 2.0 * b.x + a.x : c.y - 2.0 * b.y + a.y);
+        }
+        values.push_back(NAN);
+    }
+}
+
+// With white detection noise r and a velocity random walk q per frame, a second difference
+// has variance q dt^2 + 6 r and lag-2 covariance r. Hits and bounces are trimmed at five
+// robust standard deviations.
+static bool matchCovariances(const std::vector<double>& values, double frameS, double& velocityVariance, double& measurementVariance) {
+    std::vector<double> squares;
+    for (double v : values) {
+        if (!std::isnan(v)) squares.push_back(v * v);
+    }
+    if (squares.size() < 100) return false;
+    std::nth_element(squares.begin(), squares.begin() + squares.size() / 2, squares.end());
+    double limit = 25.0 * squares[squares.size() / 2] / 0.455;  // median of chi-square(1) = 0.455
+
+    auto usable = [&](size_t i) { return !std::isnan(values[i]) && values[i] * values[i] < limit; };
+    double sum = 0.0, lagSum = 0.0;
+    size_t count = 0, lagCount = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (!usable(i)) continue;
+        sum += values[i] * values[i];
+        count++;
+        if (i + 2 < values.size() && !std::isnan(values[i + 1]) && usable(i + 2)) {
+            lagSum += values[i] * values[i + 2];
+            lagCount++;
+        }
+    }
+    if (lagCount == 0) return false;
+    measurementVariance = std::max(lagSum / lagCount, MIN_VARIANCE);
+    velocityVariance = std::max((sum / count - 6.0 * measurementVariance) / (frameS * frameS), MIN_VARIANCE);
+    return true;
+}
+
+// E-step for one session: expected measurement residuals and process increments under the
+// smoothed posterior, using the lag-one covariance of consecutive states
+static NoiseStatistics collectStatistics(const Config& config, const std::vector<PuckPosition>& measurements,
+                                         TrackSmoother& smoother, std::vector<SmoothedState>& states) {
+    NoiseStatistics stats;
+    smoother.smooth(measurements, states, 0);
+    for (size_t k = 0; k < states.size(); ++k) {
+        const SmoothedState& s = states[k];
+        if (!s.rejected) {
+            double dx = s.measurement.x - s.state(0);
+            double dy = s.measurement.y - s.state(1);
+            stats.measurementSum += 0.5 * (dx * dx + dy * dy + s.covariance(0, 0) + s.covariance(1, 1));
+            stats.measurements++;
+        }
+        if (k == 0 || states[k - 1].track != s.track || s.rejected || states[k - 1].rejected) continue;
+
+        const SmoothedState& previous = states[k - 1];
+        const KalmanFilter::StateMatrix& F = s.transition;
+        KalmanFilter::StateVector d = s.state - F * previous.state;
+        double distance = (d(0) * d(0) + d(1) * d(1)) / config.KALMAN_POSITION_NOISE + (d(2) * d(2) + d(3) * d(3)) / config.KALMAN_VELOCITY_NOISE;
+        if (distance > MANEUVER_CHI2) {
+            stats.maneuvers++;
+            continue;
+        }
+        KalmanFilter::StateMatrix C = s.crossCovariance * F.transpose();
+        KalmanFilter::StateMatrix Q = d * d.transpose() + s.covariance - C - C.transpose() + F * previous.covariance * F.transpose();
+        stats.positionSum += 0.5 * (Q(0, 0) + Q(1, 1));
+        stats.velocitySum += 0.5 * (Q(2, 2) + Q(3, 3));
+        stats.steps++;
+    }
+    return stats;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> sessions;
+    std::string configFile = "config.json";
+    int cycles = 10;
+    bool dryRun = false;
+    int threadCount = (int)std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            if (std::filesystem::is_directory(arg)) {
+                std::vector<std::string> files;
+                for (const auto& entry : std::filesystem::directory_iterator(arg)) {
+                    if (entry.path().extension() == ".ahs") files.push_back(entry.path().string());
+                }
+                std::sort(files.begin(), files.end());
+                sessions.insert(sessions.end(), files.begin(), files.end());
+            } else {
+                sessions.push_back(arg);
+            }
+            continue;
+        }
+        if (arg == "--dry-run") {
+            dryRun = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return -1;
+        }
+        if (arg == "--cycles") cycles = std::stoi(argv[++i]);
+        else if (arg == "--threads") threadCount = std::stoi(argv[++i]);
+        else if (arg == "--config") configFile = argv[++i];
+        else {
+            printUsage();
+            return -1;
+        }
+    }
+    if (sessions.empty()) {
+        printUsage();
+        return -1;
+    }
+    if (threadCount < 1) threadCount = 1;
+
+    Config config;
+    config.loadFromFile(configFile);
+
+    // Frame decoding dominates loading; parallelism comes from the sessions themselves
+    cv::setNumThreads(1);
+    std::vector<std::vector<PuckPosition>> measurements(sessions.size());
+    std::vector<NoiseStatistics> results(sessions.size());
+    auto runParallel = [&](const std::function<void(size_t)>& job) {
+        std::atomic<size_t> nextSession(0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threadCount; ++t) {
+            workers.emplace_back([&]() {
+                for (size_t i = nextSession++; i < sessions.size(); i = nextSession++) job(i);
+            });
+        }
+        for (auto& t : workers) t.join();
+    };
+
+    std::cout << "Loading " << sessions.size() << " sessions on " << threadCount << " threads..." << std::endl;
+    runParallel([&](size_t i) {
+        if (!loadSession(sessions[i], measurements[i])) std::cerr << "Error: No puck detections in " << sessions[i] << std::endl;
+    });
+
+    // Frame interval: median over all sessions
+    std::vector<int64_t> intervals;
+    for (const std::vector<PuckPosition>& m : measurements) {
+        for (size_t k = 1; k < m.size(); ++k) intervals.push_back((int64_t)(m[k].timestamp - m[k - 1].timestamp));
+    }
+    if (intervals.empty()) {
+        std::cerr << "Error: No usable tracks in the sessions" << std::endl;
+        return -1;
+    }
+    std::nth_element(intervals.begin(), intervals.begin() + intervals.size() / 2, intervals.end());
+    double frameUs = (double)intervals[intervals.size() / 2];
+
+    std::vector<std::vector<double>> differences(sessions.size());
+    runParallel([&](size_t i) { collectSecondDifferences(measurements[i], frameUs, differences[i]); });
+    std::vector<double> allDifferences;
+    for (const std::vector<double>& d : differences) allDifferences.insert(allDifferences.end(), d.begin(), d.end());
+    double velocityVariance, measurementVariance;
+    if (matchCovariances(allDifferences, frameUs / 1000000.0, velocityVariance, measurementVariance)) {
+        config.KALMAN_VELOCITY_NOISE = (float)velocityVariance;
+        config.KALMAN_MEASUREMENT_NOISE = (float)measurementVariance;
+    } else {
+        std::cout << "Too few regular frames for covariance matching, starting from the config" << std::endl;
+    }
+
+    // One EM step from noise {position, velocity, measurement}; false without usable tracks
+    NoiseStatistics total;
+    auto emStep = [&](const double* noise, double* updated) {
+        Config stepConfig = config;
+        stepConfig.KALMAN_POSITION_NOISE = (float)noise[0];
+        stepConfig.KALMAN_VELOCITY_NOISE = (float)noise[1];
+        stepConfig.KALMAN_MEASUREMENT_NOISE = (float)noise[2];
+        stepConfig.GATE_REJECT_CHI2 = IDENTIFICATION_GATE_CHI2;
+        runParallel([&](size_t i) {
+            TrackSmoother smoother(stepConfig);
+            std::vector<SmoothedState> states;
+            results[i] = collectStatistics(stepConfig, measurements[i], smoother, states);
+        });
+        total = NoiseStatistics();
+        for (const NoiseStatistics& r : results) total.add(r);  // session order, so the result is deterministic
+        if (total.steps == 0 || total.measurements == 0) return false;
+        updated[0] = std::max(total.positionSum / total.steps, MIN_VARIANCE);
+        updated[1] = std::max(total.velocitySum / total.steps, MIN_VARIANCE);
+        updated[2] = std::max(total.measurementSum / total.measurements, MIN_VARIANCE);
+        return true;
+    };
+
+    std::cout << std::setprecision(4);
+    std::cout << "Frame interval " << frameUs / 1000.0 << " ms" << std::endl;
+    std::cout << "Start: position " << config.KALMAN_POSITION_NOISE << " mm^2, velocity " << config.KALMAN_VELOCITY_NOISE
+              << " (mm/s)^2, measurement " << config.KALMAN_MEASUREMENT_NOISE << " mm^2" << std::endl;
+
+    // Plain EM crawls when the process noise is small against the detection noise, so each
+    // cycle extrapolates two EM steps in log space (SQUAREM) and stabilizes with a third
+    double noise[3] = {config.KALMAN_POSITION_NOISE, config.KALMAN_VELOCITY_NOISE, config.KALMAN_MEASUREMENT_NOISE};
+    for (int cycle = 1; cycle <= cycles; ++cycle) {
+        double first[3], second[3], extrapolated[3], next[3];
+        if (!emStep(noise, first) || !emStep(first, second)) {
+            std::cerr << "Error: No usable tracks in the sessions" << std::endl;
+            return -1;
+        }
+        double r[3], v[3], rNorm = 0.0, vNorm = 0.0;
+        for (int k = 0; k < 3; ++k) {
+            r[k] = std::log(first[k] / noise[k]);
+            v[k] = std::log(second[k] / first[k]) - r[k];
+            rNorm += r[k] * r[k];
+            vNorm += v[k] * v[k];
+        }
+        double alpha = vNorm > 0.0 ? std::max(-std::sqrt(rNorm / vNorm), -MAX_EXTRAPOLATION) : -1.0;
+        if (alpha > -1.0) alpha = -1.0;  // -1 is the second EM step itself
+        for (int k = 0; k < 3; ++k) extrapolated[k] = noise[k] * std::exp(-2.0 * alpha * r[k] + alpha * alpha * v[k]);
+        if (!emStep(extrapolated, next)) {
+            std::cerr << "Error: No usable tracks in the sessions" << std::endl;
+            return -1;
+        }
+
+        double change = 0.0;
+        for (int k = 0; k < 3; ++k) {
+            change = std::max(change, std::abs(std::log(next[k] / noise[k])));
+            noise[k] = next[k];
+        }
+        std::cout << "Cycle " << cycle << ": position " << noise[0] << " mm^2, velocity " << noise[1]
+                  << " (mm/s)^2, measurement " << noise[2] << " mm^2 (" << total.maneuvers << " maneuver steps left out)" << std::endl;
+        if (change < 0.01) break;
+    }
+    config.KALMAN_POSITION_NOISE = (float)noise[0];
+    config.KALMAN_VELOCITY_NOISE = (float)noise[1];
+    config.KALMAN_MEASUREMENT_NOISE = (float)noise[2];
+
+    std::cout << "\n=== Identified noise from " << total.measurements << " measurements ===" << std::endl;
+    std::cout << "KALMAN_POSITION_NOISE = " << config.KALMAN_POSITION_NOISE << "  (" << std::sqrt(config.KALMAN_POSITION_NOISE) << " mm per step)" << std::endl;
+    std::cout << "KALMAN_VELOCITY_NOISE = " << config.KALMAN_VELOCITY_NOISE << "  (" << std::sqrt(config.KALMAN_VELOCITY_NOISE) << " mm/s per step)" << std::endl;
+    std::cout << "KALMAN_MEASUREMENT_NOISE = " << config.KALMAN_MEASUREMENT_NOISE << "  (" << std::sqrt(config.KALMAN_MEASUREMENT_NOISE) << " mm)" << std::endl;
+    if (!dryRun) config.saveToFile(configFile);
+    return 0;
+}
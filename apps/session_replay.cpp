@@ -0,0 +1,78 @@
+#include "session_recorder.hpp"
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: session_replay <session.ahs> [--export <dir>]" << std::endl;
+        return -1;
+    }
+    std::string exportDir;
+    if (argc >= 4 && std::string(argv[2]) == "--export") exportDir = argv[3];
+
+    SessionReader reader;
+    if (!reader.open(argv[1])) return -1;
+
+    bool show = exportDir.empty();
+    if (show) {
+        cv::namedWindow("Session Replay", cv::WINDOW_NORMAL);
+        cv::resizeWindow("Session Replay", 1280, 720);
+        std::cout << "Controls:" << std::endl;
+        std::cout << "  Space: Pause/Resume" << std::endl;
+        std::cout << "  Q: Quit" << std::endl;
+    } else {
+        std::filesystem::create_directories(exportDir);
+    }
+
+    SessionFrameRecord record;
+    cv::Mat frame;
+    uint64_t frames = 0, puckFrames = 0, commands = 0;
+    uint64_t firstTimestamp = 0, lastTimestamp = 0;
+    bool paused = false;
+    while (reader.next(record, frame)) {
+        if (frames == 0) firstTimestamp = record.timestampUs;
+        lastTimestamp = record.timestampUs;
+        frames++;
+        if (record.commandSent) commands++;
+        for (const auto& d : record.detections) {
+            if (d.kind == SESSION_DETECTION_PUCK) puckFrames++;
+        }
+        if (frame.empty()) continue;
+
+        cv::Mat view;
+        cv::cvtColor(frame, view, cv::COLOR_GRAY2BGR);
+        for (const auto& d : record.detections) {
+            cv::Scalar color = d.kind == SESSION_DETECTION_PUCK ? cv::Scalar(0, 255, 0) : cv::Scalar(255, 0, 255);
+            cv::rectangle(view, d.patchRect, color, 1);
+            cv::circle(view, d.image, 3, color, -1);
+        }
+        if (record.commandSent) {
+            cv::putText(view, "MOVE SENT", cv::Point(20, 40), cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 255, 0), 2);
+        }
+        if (record.filterValid) {
+            std::string state = "Filter v(mm/s): " + std::to_string((int)record.filterState[2]) + ", " + std::to_string((int)record.filterState[3]);
+            cv::putText(view, state, cv::Point(20, view.rows - 20), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 1);
+        }
+
+        if (!show) {
+            char filename[512];
+            snprintf(filename, sizeof(filename), "%s/%06llu.png", exportDir.c_str(), (unsigned long long)(frames - 1));
+            cv::imwrite(filename, view);
+            continue;
+        }
+
+        cv::imshow("Session Replay", view);
+        int key = cv::waitKey(paused ? 0 : 4);
+        if (key == ' ') paused = !paused;
+        if (key == 'q' || key == 'Q') break;
+    }
+
+    double durationS = (lastTimestamp - firstTimestamp) / 1000000.0;
+    std::cout << "Frames: " << frames << ", duration: " << durationS << " s";
+    if (durationS > 0) std::cout << " (" << frames / durationS << " fps)";
+    std::cout << ", puck detections: " << puckFrames << ", move commands: " << commands << std::endl;
+    if (show) cv::destroyAllWindows();
+    return 0;
+}
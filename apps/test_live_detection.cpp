@@ -1,5 +1,6 @@
 #include "capture.hpp"
 #include "trajectory.hpp"
+#include "multi_tracker.hpp"
 #include <opencv2/opencv.hpp>
 #include <iostream>
 
@@ -17,6 +18,9 @@ int main() {
     cv::resizeWindow("Live Puck Detection", 1280, 720);
 
     TrajectoryPredictor predictor(config);
+    MultiTargetTracker tracker(config);
+    std::vector<cv::Point2f> candidates;
+    std::vector<cv::Point2f> tableCandidates;
 
     bool running = true;
     bool paused = false;
@@ -38,14 +42,32 @@ int main() {
 
             cv::Mat gray;
             cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-            cv::Point2f puckCenter = capture.detectPuck(gray);
+            capture.detectPuckCandidates(gray, candidates);
+            cv::Point2f puckCenter = candidates.empty() ? cv::Point2f(-1, -1) : candidates[0];
+
+            // Every candidate goes to the multi-target tracker; the best one also feeds the puck predictor
+            tableCandidates.clear();
+            for (const cv::Point2f& c : candidates) {
+                tableCandidates.push_back(capture.imageToTableCoordinates(c, capture.getCroppedWidth(), capture.getCroppedHeight()));
+            }
+            tracker.update(tableCandidates, capture.getFrameMetadata().timestampUs);
+            for (int i = 0; i < tracker.getTrackCount(); ++i) {
+                TrackState track = tracker.getTrack(i);
+                if (!track.confirmed) continue;
+                cv::Point2f p = capture.TableToImageCoordinates(track.position, capture.getCroppedWidth(), capture.getCroppedHeight());
+                cv::Point2f ahead = capture.TableToImageCoordinates(track.position + track.velocity * 0.1f, capture.getCroppedWidth(), capture.getCroppedHeight());
+                cv::Scalar color = track.misses > 0 ? cv::Scalar(128, 128, 128) : cv::Scalar(255, 255, 0);
+                cv::circle(frame, p, 14, color, 2);
+                cv::line(frame, p, ahead, color, 2);  // 100 ms of travel
+                cv::putText(frame, "#" + std::to_string(track.id), p + cv::Point2f(16, -10), cv::FONT_HERSHEY_SIMPLEX, 0.5, color, 1);
+            }
 
             // Overlay puck detection
             if (puckCenter.x >= 0 && puckCenter.y >= 0) {
                 cv::circle(frame, puckCenter, 10, cv::Scalar(0, 255, 0), -1);  // Green circle
                 cv::putText(frame, "Puck", puckCenter + cv::Point2f(15, 0), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 0), 1);
 
-                PuckPosition puckPos = {capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight()), currentTimeUs};
+                PuckPosition puckPos = {capture.imageToTableCoordinates(puckCenter, capture.getCroppedWidth(), capture.getCroppedHeight()), capture.getFrameMetadata().rowTimestampUs(puckCenter.y)};
                 
                 predictor.addMeasurement(puckPos);
                 std::cout << "Detected Puck Position (Table Coords): " << puckPos.position << " at " << puckPos.timestamp << " us" << std::endl;
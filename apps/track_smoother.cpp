@@ -0,0 +1,209 @@
+#include "session_recorder.hpp"
+#include "smoother.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Offline trajectory reconstruction from recorded sessions. Puck detections are run
+// through a forward filter and an RTS smoother; the smoothed tracks are written as CSV
+// and serve as ground truth to score the raw detections and the online filter against.
+
+struct SessionResult {
+    std::string name;
+    bool ok = false;
+    size_t measurements = 0;
+    size_t rejected = 0;
+    int tracks = 0;
+    double detectionRmsMm = 0.0;       // raw detections vs smoothed position
+    size_t filterSamples = 0;
+    double filterPositionRmsMm = 0.0;  // online filter vs smoothed state
+    double filterVelocityRmsMmS = 0.0;
+};
+
+static void printUsage() {
+    std::cout << "Usage: track_smoother <session.ahs|dir>... [options]" << std::endl;
+    std::cout << "  --lag <n>          Fixed-lag smoothing over n measurements (default 0 = full RTS)" << std::endl;
+    std::cout << "  --threads <n>      Worker threads (default: all cores)" << std::endl;
+    std::cout << "  --out <dir>        Output directory (default smoothed_tracks)" << std::endl;
+}
+
+// Online filter estimate recorded with a frame, tagged with the detection it was updated with
+struct RecordedEstimate {
+    uint64_t timestamp;
+    KalmanFilter::StateVector state;
+};
+
+static bool loadSession(const std::string& filename, std::vector<PuckPosition>& measurements, std::vector<RecordedEstimate>& estimates) {
+    SessionReader reader;
+    if (!reader.open(filename)) return false;
+    SessionFrameRecord record;
+    cv::Mat frame;
+    while (reader.next(record, frame)) {
+        for (const SessionDetection& d : record.detections) {
+            if (d.kind != SESSION_DETECTION_PUCK) continue;
+            measurements.push_back({d.table, d.timestampUs});
+            if (record.filterValid) {
+                RecordedEstimate e;
+                e.timestamp = d.timestampUs;
+                e.state << record.filterState[0], record.filterState[1], record.filterState[2], record.filterState[3];
+                estimates.push_back(e);
+            }
+            break;  // the live loop only tracks one puck per frame
+        }
+    }
+    return !measurements.empty();
+}
+
+static bool writeTrack(const std::string& filename, const std::vector<SmoothedState>& states) {
+    std::ofstream csv(filename);
+    if (!csv.is_open()) {
+        std::cerr << "Error: Could not write " << filename << std::endl;
+        return false;
+    }
+    csv << "timestamp_us,track,meas_x,meas_y,x,y,vx,vy,std_x,std_y,rejected" << std::endl;
+    csv << std::fixed << std::setprecision(3);
+    for (const SmoothedState& s : states) {
+        csv << s.timestamp << "," << s.track << "," << s.measurement.x << "," << s.measurement.y << ","
+            << s.state(0) << "," << s.state(1) << "," << s.state(2) << "," << s.state(3) << ","
+            << std::sqrt(s.covariance(0, 0)) << "," << std::sqrt(s.covariance(1, 1)) << "," << (s.rejected ? 1 : 0) << std::endl;
+    }
+    return true;
+}
+
+static void scoreSession(SessionResult& result, const std::vector<SmoothedState>& states, const std::vector<RecordedEstimate>& estimates) {
+    double detectionSq = 0.0;
+    size_t used = 0;
+    for (const SmoothedState& s : states) {
+        if (s.rejected) {
+            result.rejected++;
+            continue;
+        }
+        double dx = s.measurement.x - s.state(0);
+        double dy = s.measurement.y - s.state(1);
+        detectionSq += dx * dx + dy * dy;
+        used++;
+    }
+    result.measurements = states.size();
+    result.tracks = states.empty() ? 0 : states.back().track + 1;
+    result.detectionRmsMm = used > 0 ? std::sqrt(detectionSq / used) : 0.0;
+
+    // Both lists are in timestamp order
+    double positionSq = 0.0, velocitySq = 0.0;
+    size_t k = 0;
+    for (const RecordedEstimate& e : estimates) {
+        while (k < states.size() && states[k].timestamp < e.timestamp) k++;
+        if (k == states.size()) break;
+        if (states[k].timestamp != e.timestamp) continue;
+        KalmanFilter::StateVector error = e.state - states[k].state;
+        positionSq += error.head<2>().squaredNorm();
+        velocitySq += error.tail<2>().squaredNorm();
+        result.filterSamples++;
+    }
+    if (result.filterSamples > 0) {
+        result.filterPositionRmsMm = std::sqrt(positionSq / result.filterSamples);
+        result.filterVelocityRmsMmS = std::sqrt(velocitySq / result.filterSamples);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> sessions;
+    std::string outDir = "smoothed_tracks";
+    int lag = 0;
+    int threadCount = (int)std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            if (std::filesystem::is_directory(arg)) {
+                std::vector<std::string> files;
+                for (const auto& entry : std::filesystem::directory_iterator(arg)) {
+                    if (entry.path().extension() == ".ahs") files.push_back(entry.path().string());
+                }
+                std::sort(files.begin(), files.end());
+                sessions.insert(sessions.end(), files.begin(), files.end());
+            } else {
+                sessions.push_back(arg);
+            }
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return -1;
+        }
+        if (arg == "--lag") lag = std::stoi(argv[++i]);
+        else if (arg == "--threads") threadCount = std::stoi(argv[++i]);
+        else if (arg == "--out") outDir = argv[++i];
+        else {
+            printUsage();
+            return -1;
+        }
+    }
+    if (sessions.empty()) {
+        printUsage();
+        return -1;
+    }
+    if (threadCount < 1) threadCount = 1;
+
+    Config config;
+    config.loadFromFile();
+
+    std::error_code ec;
+    std::filesystem::create_directories(outDir, ec);
+    if (ec) {
+        std::cerr << "Error: could not create directory '" << outDir << "': " << ec.message() << std::endl;
+        return -1;
+    }
+
+    std::cout << "Smoothing " << sessions.size() << " sessions on " << threadCount << " threads"
+              << (lag > 0 ? " (fixed lag " + std::to_string(lag) + ")" : "") << "..." << std::endl;
+
+    // Frame decoding dominates; parallelism comes from the sessions themselves
+    cv::setNumThreads(1);
+
+    std::vector<SessionResult> results(sessions.size());
+    std::atomic<size_t> nextSession(0);
+    auto worker = [&]() {
+        TrackSmoother smoother(config);
+        std::vector<PuckPosition> measurements;
+        std::vector<RecordedEstimate> estimates;
+        std::vector<SmoothedState> states;
+        for (size_t i = nextSession++; i < sessions.size(); i = nextSession++) {
+            SessionResult& result = results[i];
+            result.name = std::filesystem::path(sessions[i]).stem().string();
+            measurements.clear();
+            estimates.clear();
+            if (!loadSession(sessions[i], measurements, estimates)) {
+                std::cerr << "Error: No puck detections in " << sessions[i] << std::endl;
+                continue;
+            }
+            smoother.smooth(measurements, states, lag);
+            scoreSession(result, states, estimates);
+            result.ok = writeTrack(outDir + "/" + result.name + "_smoothed.csv", states);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; ++t) workers.emplace_back(worker);
+    for (auto& t : workers) t.join();
+
+    std::ofstream summary(outDir + "/summary.csv");
+    summary << "session,measurements,rejected,tracks,detection_rms_mm,filter_samples,filter_position_rms_mm,filter_velocity_rms_mm_s" << std::endl;
+    std::cout << "\n=== Scores against the smoothed tracks ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const SessionResult& r : results) {
+        if (!r.ok) continue;
+        summary << r.name << "," << r.measurements << "," << r.rejected << "," << r.tracks << "," << r.detectionRmsMm << ","
+                << r.filterSamples << "," << r.filterPositionRmsMm << "," << r.filterVelocityRmsMmS << std::endl;
+        std::cout << r.name << "  meas=" << r.measurements << " rejected=" << r.rejected << " tracks=" << r.tracks
+                  << "  detection=" << r.detectionRmsMm << " mm"
+                  << "  filter=" << r.filterPositionRmsMm << " mm / " << r.filterVelocityRmsMmS << " mm/s" << std::endl;
+    }
+    std::cout << "Results written to " << outDir << std::endl;
+    return 0;
+}
@@ -12,6 +12,7 @@ public:
     int CAMERA_INDEX = 0;  // Camera device index
     bool USE_LIBCAMERA_BOOL = false;  // For use in code
     bool ENABLE_UNDISTORTION = false;  // Enable real-time lens distortion correction
+    double ROLLING_SHUTTER_LINE_TIME_US = 0.0;  // Sensor line readout time in us (0 = treat as global shutter)
 
     // Calibration parameters
     int CHESSBOARD_WIDTH = 9;   // Number of internal corners per row
@@ -39,12 +40,110 @@ public:
     int TABLE_DETECT_THRESHOLD = 150; // Threshold for table detection 
     int PUCK_MIN_AREA = 150; // Minimum area for blob detection
     int PUCK_MAX_AREA = 10000; // Maximum area for blob detection
+    float PUCK_MIN_CIRCULARITY = 0.5f; // Minimum 4*pi*area/perimeter^2 for a blob to count as the puck
+
+    // Kalman filter noise, identified offline from recorded sessions with noise_identification
+    float KALMAN_POSITION_NOISE = 0.01f;      // Position process noise variance added per prediction step (mm^2)
+    float KALMAN_VELOCITY_NOISE = 0.5f;       // Velocity process noise variance added per prediction step ((mm/s)^2)
+    float KALMAN_MEASUREMENT_NOISE = 0.1f;    // Detection noise variance (mm^2)
+
+    // Trajectory filter: interacting multiple model (constant velocity / friction / maneuver)
+    bool IMM_ENABLED = true;
+    float IMM_FRICTION_DECAY = 0.3f;          // Velocity decay rate of the friction model (1/s)
+    float IMM_MANEUVER_NOISE_SCALE = 1e3f;    // Velocity process noise multiplier of the maneuver model
+    float IMM_MODE_STAY_PROBABILITY = 0.9f;   // Probability of staying in the same model between frames
+    int TRAJECTORY_ESTIMATOR = 0;             // 0 = Kalman filter (IMM), 1 = RANSAC line fit over the current leg
+    int LINE_FIT_WINDOW = 24;                 // Most recent samples of the leg kept for the line fit
+    float LINE_FIT_INLIER_MM = 3.0f;          // RANSAC inlier distance from the line
+    float LINE_FIT_BREAK_MM = 8.0f;           // Two samples in a row this far off the line start a new leg
+    int LINE_FIT_ITERATIONS = 32;             // RANSAC hypotheses per update (all pairs when there are fewer)
+    int TRACK_INIT_SAMPLES = 3;               // Detections fitted by least squares to seed a new track (1 = first detection, zero velocity)
+    float TRACK_INIT_VELOCITY_STD = 3000.0f;  // Velocity std of a new track (mm/s): any puck speed must pass the innovation gate
+    float TRACK_MAX_GAP_S = 0.1f;             // Longer detection gaps start a new track or leg (smoother, line fit, physics estimation)
+    int OOSM_HISTORY_LENGTH = 16;             // Measurements kept to apply a late one at its own time (0 = drop late measurements)
+    float ENTRY_HEDGE_SPREAD_MM = 30.0f;      // Entry spread along the goal line at which the target is pulled halfway to the goal centre
+
+    // Table physics used by the predictor, identified online from tracked bounces and glides
+    float WALL_RESTITUTION_X_MIN = 1.0f;      // Fraction of the normal speed kept by a bounce off each wall
+    float WALL_RESTITUTION_X_MAX = 1.0f;
+    float WALL_RESTITUTION_Y_MIN = 1.0f;
+    float WALL_RESTITUTION_Y_MAX = 1.0f;
+    float GLIDE_DECAY = 0.0f;                 // Velocity decay rate of a free glide (1/s)
+    bool PHYSICS_ESTIMATION_ENABLED = true;   // Fit the values above during play and write them to physics_estimate.json on exit
+    int PHYSICS_MIN_SAMPLES = 5;              // Bounces per wall (or glides) before an estimate is used
+
+    // Measurement gating on the squared Mahalanobis distance of the innovation (chi-square, 2 dof)
+    bool GATE_ENABLED = true;
+    float GATE_CHI2 = 9.21f;                  // Beyond this (99%) measurements are down-weighted
+    float GATE_REJECT_CHI2 = 400.0f;          // Beyond this measurements are rejected
+    int GATE_MAX_CONSECUTIVE_REJECTS = 3;     // Re-initialize the track after this many rejections in a row
+
+    // Event detection (hits, bounces, stops) on the innovation sequence
+    bool EVENT_DETECTION_ENABLED = true;
+    float EVENT_CHI2 = 13.8f;                 // Two innovations in a row beyond this (99.9%), on the same side, are an event
+    float EVENT_VELOCITY_STD = 3000.0f;       // Velocity uncertainty the filter restarts with at an event (mm/s)
+    float EVENT_STOP_SPEED = 30.0f;           // Below this speed after an event the puck is taken as stopped (mm/s)
+    float EVENT_WALL_MARGIN = 15.0f;          // Events within this distance of a wall can be bounces (mm)
+
+    // Multi-target tracker (several pucks and mallets at once)
+    float TRACKER_ACCEL_STD = 20000.0f;       // White-noise acceleration of a track (mm/s^2)
+    float TRACKER_MEASUREMENT_STD = 2.0f;     // Detection noise (mm)
+    float TRACKER_GATE_CHI2 = 13.8f;          // Detections beyond this (99.9%) are never associated with a track
+    int TRACKER_CONFIRM_HITS = 3;             // Updates before a new track is confirmed
+    int TRACKER_MAX_MISSES = 10;              // Frames without a detection before a confirmed track is dropped
+
+    // Opponent mallet parameters
+    bool ENABLE_MALLET_TRACKING = false; // Detect and track the opponent mallet for shot anticipation
+    int MALLET_RADIUS_REAL = 40;  // Mallet radius in mm
+    int MALLET_THRESHOLD = 100;   // Threshold for mallet detection
+    int MALLET_MIN_AREA = 1000;   // Minimum area for mallet blob
+    int MALLET_MAX_AREA = 20000;  // Maximum area for mallet blob
+    float MALLET_RESTITUTION = 0.8f;  // Restitution of a mallet hit on the puck
+    int MALLET_CONTACT_HORIZON_MS = 150;  // How far ahead to look for a mallet-puck contact
+
+    // Idle mode: decimated processing while nothing moves
+    bool IDLE_ENABLED = true;
+    float IDLE_TIMEOUT_S = 10.0f;       // Seconds without puck motion before going idle
+    int IDLE_FRAME_DECIMATION = 4;      // While idle, check only every k-th frame
+    int IDLE_DIFF_THRESHOLD = 25;       // Gray-level change that counts as a changed pixel
+    int IDLE_MIN_CHANGED_PIXELS = 4;    // Changed pixels (in the downsampled frame) needed to wake up
+
+    // Session recording
+    bool RECORD_SESSION = false;          // Record every frame to a compact session file
+    int SESSION_PATCH_RADIUS = 24;        // Half size of the patch stored around each detection (px)
+    int SESSION_KEYFRAME_INTERVAL = 1200; // Frames between full keyframes
+    int SESSION_BUFFER_MB = 8;            // Size of each of the two preallocated write buffers
 
     // Robot configuration
     std::string ROBOT_IP = "10.25.74.172";  
     double TABLE_OFFSET_X = 0.0;             // Offset from table origin to robot origin in mm
     double TABLE_OFFSET_Y = 0.0;
     double TABLE_HEIGHT_Z = 0.0;             // Table height in mm
+    float ACTUATION_DELAY_MS = 40.0f;        // UDP transit plus RAPID MoveAbsJ start-up before the robot moves
+    float PREDICTION_SERVICE_RATE_HZ = 500.0f;  // defense moves sent between frames at this rate (0 = from the camera loop only)
+
+    // Walls of the collision model (0 = x min, 1 = x max, 2 = y min, 3 = y max): table edges
+    // inset by the puck radius, as seen by the puck centre
+    double wallCoordinate(int wall) const {
+        double r = PUCK_RADIUS_REAL;
+        switch (wall) {
+            case 0: return r;
+            case 1: return PHYSICAL_TABLE_WIDTH - r;
+            case 2: return r;
+            case 3: return PHYSICAL_TABLE_HEIGHT - r;
+            default: return 0.0;
+        }
+    }
+
+    double wallRestitution(int wall) const {
+        switch (wall) {
+            case 0: return WALL_RESTITUTION_X_MIN;
+            case 1: return WALL_RESTITUTION_X_MAX;
+            case 2: return WALL_RESTITUTION_Y_MIN;
+            case 3: return WALL_RESTITUTION_Y_MAX;
+            default: return 1.0;
+        }
+    }
 
     void loadFromFile(const std::string& filename = "config.json") {
         try {
@@ -77,6 +176,7 @@ public:
         // Camera configuration
         CAMERA_INDEX = 0;
         USE_LIBCAMERA_BOOL = false;
+        ROLLING_SHUTTER_LINE_TIME_US = 0.0;
 
         // Calibration parameters
         CHESSBOARD_WIDTH = 9;
@@ -104,12 +204,87 @@ public:
         TABLE_DETECT_THRESHOLD = 150;
         PUCK_MIN_AREA = 150;
         PUCK_MAX_AREA = 10000;
+        PUCK_MIN_CIRCULARITY = 0.5f;
+
+        // Kalman filter noise
+        KALMAN_POSITION_NOISE = 0.01f;
+        KALMAN_VELOCITY_NOISE = 0.5f;
+        KALMAN_MEASUREMENT_NOISE = 0.1f;
+
+        // Trajectory filter
+        IMM_ENABLED = true;
+        IMM_FRICTION_DECAY = 0.3f;
+        IMM_MANEUVER_NOISE_SCALE = 1e3f;
+        IMM_MODE_STAY_PROBABILITY = 0.9f;
+        TRACK_INIT_SAMPLES = 3;
+        TRACK_INIT_VELOCITY_STD = 3000.0f;
+        TRACK_MAX_GAP_S = 0.1f;
+        OOSM_HISTORY_LENGTH = 16;
+        TRAJECTORY_ESTIMATOR = 0;
+        LINE_FIT_WINDOW = 24;
+        LINE_FIT_INLIER_MM = 3.0f;
+        LINE_FIT_BREAK_MM = 8.0f;
+        LINE_FIT_ITERATIONS = 32;
+        ENTRY_HEDGE_SPREAD_MM = 30.0f;
+
+        // Table physics
+        WALL_RESTITUTION_X_MIN = 1.0f;
+        WALL_RESTITUTION_X_MAX = 1.0f;
+        WALL_RESTITUTION_Y_MIN = 1.0f;
+        WALL_RESTITUTION_Y_MAX = 1.0f;
+        GLIDE_DECAY = 0.0f;
+        PHYSICS_ESTIMATION_ENABLED = true;
+        PHYSICS_MIN_SAMPLES = 5;
+
+        // Measurement gating
+        GATE_ENABLED = true;
+        GATE_CHI2 = 9.21f;
+        GATE_REJECT_CHI2 = 400.0f;
+        GATE_MAX_CONSECUTIVE_REJECTS = 3;
+
+        // Event detection
+        EVENT_DETECTION_ENABLED = true;
+        EVENT_CHI2 = 13.8f;
+        EVENT_VELOCITY_STD = 3000.0f;
+        EVENT_STOP_SPEED = 30.0f;
+        EVENT_WALL_MARGIN = 15.0f;
+
+        // Multi-target tracker
+        TRACKER_ACCEL_STD = 20000.0f;
+        TRACKER_MEASUREMENT_STD = 2.0f;
+        TRACKER_GATE_CHI2 = 13.8f;
+        TRACKER_CONFIRM_HITS = 3;
+        TRACKER_MAX_MISSES = 10;
+
+        // Opponent mallet parameters
+        ENABLE_MALLET_TRACKING = false;
+        MALLET_RADIUS_REAL = 40;
+        MALLET_THRESHOLD = 100;
+        MALLET_MIN_AREA = 1000;
+        MALLET_MAX_AREA = 20000;
+        MALLET_RESTITUTION = 0.8f;
+        MALLET_CONTACT_HORIZON_MS = 150;
+
+        // Idle mode
+        IDLE_ENABLED = true;
+        IDLE_TIMEOUT_S = 10.0f;
+        IDLE_FRAME_DECIMATION = 4;
+        IDLE_DIFF_THRESHOLD = 25;
+        IDLE_MIN_CHANGED_PIXELS = 4;
+
+        // Session recording
+        RECORD_SESSION = false;
+        SESSION_PATCH_RADIUS = 24;
+        SESSION_KEYFRAME_INTERVAL = 1200;
+        SESSION_BUFFER_MB = 8;
 
         // Robot configuration
         ROBOT_IP = "10.25.74.172";
         TABLE_OFFSET_X = 0.0;
         TABLE_OFFSET_Y = 0.0;
         TABLE_HEIGHT_Z = 0.0;
+        ACTUATION_DELAY_MS = 40.0f;
+        PREDICTION_SERVICE_RATE_HZ = 500.0f;
     }
 
 private:
@@ -117,6 +292,7 @@ private:
         j = nlohmann::json{
             {"CAMERA_INDEX", c.CAMERA_INDEX},
             {"USE_LIBCAMERA_BOOL", c.USE_LIBCAMERA_BOOL},
+            {"ROLLING_SHUTTER_LINE_TIME_US", c.ROLLING_SHUTTER_LINE_TIME_US},
             {"CHESSBOARD_WIDTH", c.CHESSBOARD_WIDTH},
             {"CHESSBOARD_HEIGHT", c.CHESSBOARD_HEIGHT},
             {"SQUARE_SIZE", c.SQUARE_SIZE},
@@ -135,16 +311,74 @@ private:
             {"TABLE_DETECT_THRESHOLD", c.TABLE_DETECT_THRESHOLD},
             {"PUCK_MIN_AREA", c.PUCK_MIN_AREA},
             {"PUCK_MAX_AREA", c.PUCK_MAX_AREA},
+            {"PUCK_MIN_CIRCULARITY", c.PUCK_MIN_CIRCULARITY},
+            {"KALMAN_POSITION_NOISE", c.KALMAN_POSITION_NOISE},
+            {"KALMAN_VELOCITY_NOISE", c.KALMAN_VELOCITY_NOISE},
+            {"KALMAN_MEASUREMENT_NOISE", c.KALMAN_MEASUREMENT_NOISE},
+            {"IMM_ENABLED", c.IMM_ENABLED},
+            {"IMM_FRICTION_DECAY", c.IMM_FRICTION_DECAY},
+            {"IMM_MANEUVER_NOISE_SCALE", c.IMM_MANEUVER_NOISE_SCALE},
+            {"IMM_MODE_STAY_PROBABILITY", c.IMM_MODE_STAY_PROBABILITY},
+            {"TRACK_INIT_SAMPLES", c.TRACK_INIT_SAMPLES},
+            {"TRACK_INIT_VELOCITY_STD", c.TRACK_INIT_VELOCITY_STD},
+            {"TRACK_MAX_GAP_S", c.TRACK_MAX_GAP_S},
+            {"OOSM_HISTORY_LENGTH", c.OOSM_HISTORY_LENGTH},
+            {"TRAJECTORY_ESTIMATOR", c.TRAJECTORY_ESTIMATOR},
+            {"LINE_FIT_WINDOW", c.LINE_FIT_WINDOW},
+            {"LINE_FIT_INLIER_MM", c.LINE_FIT_INLIER_MM},
+            {"LINE_FIT_BREAK_MM", c.LINE_FIT_BREAK_MM},
+            {"LINE_FIT_ITERATIONS", c.LINE_FIT_ITERATIONS},
+            {"ENTRY_HEDGE_SPREAD_MM", c.ENTRY_HEDGE_SPREAD_MM},
+            {"WALL_RESTITUTION_X_MIN", c.WALL_RESTITUTION_X_MIN},
+            {"WALL_RESTITUTION_X_MAX", c.WALL_RESTITUTION_X_MAX},
+            {"WALL_RESTITUTION_Y_MIN", c.WALL_RESTITUTION_Y_MIN},
+            {"WALL_RESTITUTION_Y_MAX", c.WALL_RESTITUTION_Y_MAX},
+            {"GLIDE_DECAY", c.GLIDE_DECAY},
+            {"PHYSICS_ESTIMATION_ENABLED", c.PHYSICS_ESTIMATION_ENABLED},
+            {"PHYSICS_MIN_SAMPLES", c.PHYSICS_MIN_SAMPLES},
+            {"GATE_ENABLED", c.GATE_ENABLED},
+            {"GATE_CHI2", c.GATE_CHI2},
+            {"GATE_REJECT_CHI2", c.GATE_REJECT_CHI2},
+            {"GATE_MAX_CONSECUTIVE_REJECTS", c.GATE_MAX_CONSECUTIVE_REJECTS},
+            {"EVENT_DETECTION_ENABLED", c.EVENT_DETECTION_ENABLED},
+            {"EVENT_CHI2", c.EVENT_CHI2},
+            {"EVENT_VELOCITY_STD", c.EVENT_VELOCITY_STD},
+            {"EVENT_STOP_SPEED", c.EVENT_STOP_SPEED},
+            {"EVENT_WALL_MARGIN", c.EVENT_WALL_MARGIN},
+            {"TRACKER_ACCEL_STD", c.TRACKER_ACCEL_STD},
+            {"TRACKER_MEASUREMENT_STD", c.TRACKER_MEASUREMENT_STD},
+            {"TRACKER_GATE_CHI2", c.TRACKER_GATE_CHI2},
+            {"TRACKER_CONFIRM_HITS", c.TRACKER_CONFIRM_HITS},
+            {"TRACKER_MAX_MISSES", c.TRACKER_MAX_MISSES},
+            {"ENABLE_MALLET_TRACKING", c.ENABLE_MALLET_TRACKING},
+            {"MALLET_RADIUS_REAL", c.MALLET_RADIUS_REAL},
+            {"MALLET_THRESHOLD", c.MALLET_THRESHOLD},
+            {"MALLET_MIN_AREA", c.MALLET_MIN_AREA},
+            {"MALLET_MAX_AREA", c.MALLET_MAX_AREA},
+            {"MALLET_RESTITUTION", c.MALLET_RESTITUTION},
+            {"MALLET_CONTACT_HORIZON_MS", c.MALLET_CONTACT_HORIZON_MS},
+            {"IDLE_ENABLED", c.IDLE_ENABLED},
+            {"IDLE_TIMEOUT_S", c.IDLE_TIMEOUT_S},
+            {"IDLE_FRAME_DECIMATION", c.IDLE_FRAME_DECIMATION},
+            {"IDLE_DIFF_THRESHOLD", c.IDLE_DIFF_THRESHOLD},
+            {"IDLE_MIN_CHANGED_PIXELS", c.IDLE_MIN_CHANGED_PIXELS},
+            {"RECORD_SESSION", c.RECORD_SESSION},
+            {"SESSION_PATCH_RADIUS", c.SESSION_PATCH_RADIUS},
+            {"SESSION_KEYFRAME_INTERVAL", c.SESSION_KEYFRAME_INTERVAL},
+            {"SESSION_BUFFER_MB", c.SESSION_BUFFER_MB},
             {"ROBOT_IP", c.ROBOT_IP},
             {"TABLE_OFFSET_X", c.TABLE_OFFSET_X},
             {"TABLE_OFFSET_Y", c.TABLE_OFFSET_Y},
-            {"TABLE_HEIGHT_Z", c.TABLE_HEIGHT_Z}
+            {"TABLE_HEIGHT_Z", c.TABLE_HEIGHT_Z},
+            {"ACTUATION_DELAY_MS", c.ACTUATION_DELAY_MS},
+            {"PREDICTION_SERVICE_RATE_HZ", c.PREDICTION_SERVICE_RATE_HZ}
         };
     }
 
     friend void from_json(const nlohmann::json& j, Config& c) {
         c.CAMERA_INDEX = j.value("CAMERA_INDEX", 0);
         c.USE_LIBCAMERA_BOOL = j.value("USE_LIBCAMERA_BOOL", true);
+        c.ROLLING_SHUTTER_LINE_TIME_US = j.value("ROLLING_SHUTTER_LINE_TIME_US", 0.0);
         c.CHESSBOARD_WIDTH = j.value("CHESSBOARD_WIDTH", 9);
         c.CHESSBOARD_HEIGHT = j.value("CHESSBOARD_HEIGHT", 6);
         c.SQUARE_SIZE = j.value("SQUARE_SIZE", 25.0f);
@@ -163,10 +397,67 @@ private:
         c.TABLE_DETECT_THRESHOLD = j.value("TABLE_DETECT_THRESHOLD", 150);
         c.PUCK_MIN_AREA = j.value("PUCK_MIN_AREA", 150);
         c.PUCK_MAX_AREA = j.value("PUCK_MAX_AREA", 10000);
+        c.PUCK_MIN_CIRCULARITY = j.value("PUCK_MIN_CIRCULARITY", 0.5f);
+        c.KALMAN_POSITION_NOISE = j.value("KALMAN_POSITION_NOISE", 0.01f);
+        c.KALMAN_VELOCITY_NOISE = j.value("KALMAN_VELOCITY_NOISE", 0.5f);
+        c.KALMAN_MEASUREMENT_NOISE = j.value("KALMAN_MEASUREMENT_NOISE", 0.1f);
+        c.IMM_ENABLED = j.value("IMM_ENABLED", true);
+        c.IMM_FRICTION_DECAY = j.value("IMM_FRICTION_DECAY", 0.3f);
+        c.IMM_MANEUVER_NOISE_SCALE = j.value("IMM_MANEUVER_NOISE_SCALE", 1e3f);
+        c.IMM_MODE_STAY_PROBABILITY = j.value("IMM_MODE_STAY_PROBABILITY", 0.9f);
+        c.TRACK_INIT_SAMPLES = j.value("TRACK_INIT_SAMPLES", 3);
+        c.TRACK_INIT_VELOCITY_STD = j.value("TRACK_INIT_VELOCITY_STD", 3000.0f);
+        c.TRACK_MAX_GAP_S = j.value("TRACK_MAX_GAP_S", 0.1f);
+        c.OOSM_HISTORY_LENGTH = j.value("OOSM_HISTORY_LENGTH", 16);
+        c.TRAJECTORY_ESTIMATOR = j.value("TRAJECTORY_ESTIMATOR", 0);
+        c.LINE_FIT_WINDOW = j.value("LINE_FIT_WINDOW", 24);
+        c.LINE_FIT_INLIER_MM = j.value("LINE_FIT_INLIER_MM", 3.0f);
+        c.LINE_FIT_BREAK_MM = j.value("LINE_FIT_BREAK_MM", 8.0f);
+        c.LINE_FIT_ITERATIONS = j.value("LINE_FIT_ITERATIONS", 32);
+        c.ENTRY_HEDGE_SPREAD_MM = j.value("ENTRY_HEDGE_SPREAD_MM", 30.0f);
+        c.WALL_RESTITUTION_X_MIN = j.value("WALL_RESTITUTION_X_MIN", 1.0f);
+        c.WALL_RESTITUTION_X_MAX = j.value("WALL_RESTITUTION_X_MAX", 1.0f);
+        c.WALL_RESTITUTION_Y_MIN = j.value("WALL_RESTITUTION_Y_MIN", 1.0f);
+        c.WALL_RESTITUTION_Y_MAX = j.value("WALL_RESTITUTION_Y_MAX", 1.0f);
+        c.GLIDE_DECAY = j.value("GLIDE_DECAY", 0.0f);
+        c.PHYSICS_ESTIMATION_ENABLED = j.value("PHYSICS_ESTIMATION_ENABLED", true);
+        c.PHYSICS_MIN_SAMPLES = j.value("PHYSICS_MIN_SAMPLES", 5);
+        c.GATE_ENABLED = j.value("GATE_ENABLED", true);
+        c.GATE_CHI2 = j.value("GATE_CHI2", 9.21f);
+        c.GATE_REJECT_CHI2 = j.value("GATE_REJECT_CHI2", 400.0f);
+        c.GATE_MAX_CONSECUTIVE_REJECTS = j.value("GATE_MAX_CONSECUTIVE_REJECTS", 3);
+        c.EVENT_DETECTION_ENABLED = j.value("EVENT_DETECTION_ENABLED", true);
+        c.EVENT_CHI2 = j.value("EVENT_CHI2", 13.8f);
+        c.EVENT_VELOCITY_STD = j.value("EVENT_VELOCITY_STD", 3000.0f);
+        c.EVENT_STOP_SPEED = j.value("EVENT_STOP_SPEED", 30.0f);
+        c.EVENT_WALL_MARGIN = j.value("EVENT_WALL_MARGIN", 15.0f);
+        c.TRACKER_ACCEL_STD = j.value("TRACKER_ACCEL_STD", 20000.0f);
+        c.TRACKER_MEASUREMENT_STD = j.value("TRACKER_MEASUREMENT_STD", 2.0f);
+        c.TRACKER_GATE_CHI2 = j.value("TRACKER_GATE_CHI2", 13.8f);
+        c.TRACKER_CONFIRM_HITS = j.value("TRACKER_CONFIRM_HITS", 3);
+        c.TRACKER_MAX_MISSES = j.value("TRACKER_MAX_MISSES", 10);
+        c.ENABLE_MALLET_TRACKING = j.value("ENABLE_MALLET_TRACKING", false);
+        c.MALLET_RADIUS_REAL = j.value("MALLET_RADIUS_REAL", 40);
+        c.MALLET_THRESHOLD = j.value("MALLET_THRESHOLD", 100);
+        c.MALLET_MIN_AREA = j.value("MALLET_MIN_AREA", 1000);
+        c.MALLET_MAX_AREA = j.value("MALLET_MAX_AREA", 20000);
+        c.MALLET_RESTITUTION = j.value("MALLET_RESTITUTION", 0.8f);
+        c.MALLET_CONTACT_HORIZON_MS = j.value("MALLET_CONTACT_HORIZON_MS", 150);
+        c.IDLE_ENABLED = j.value("IDLE_ENABLED", true);
+        c.IDLE_TIMEOUT_S = j.value("IDLE_TIMEOUT_S", 10.0f);
+        c.IDLE_FRAME_DECIMATION = j.value("IDLE_FRAME_DECIMATION", 4);
+        c.IDLE_DIFF_THRESHOLD = j.value("IDLE_DIFF_THRESHOLD", 25);
+        c.IDLE_MIN_CHANGED_PIXELS = j.value("IDLE_MIN_CHANGED_PIXELS", 4);
+        c.RECORD_SESSION = j.value("RECORD_SESSION", false);
+        c.SESSION_PATCH_RADIUS = j.value("SESSION_PATCH_RADIUS", 24);
+        c.SESSION_KEYFRAME_INTERVAL = j.value("SESSION_KEYFRAME_INTERVAL", 1200);
+        c.SESSION_BUFFER_MB = j.value("SESSION_BUFFER_MB", 8);
         c.ROBOT_IP = j.value("ROBOT_IP", "10.25.74.172");
         c.TABLE_OFFSET_X = j.value("TABLE_OFFSET_X", 0.0);
         c.TABLE_OFFSET_Y = j.value("TABLE_OFFSET_Y", 0.0);
         c.TABLE_HEIGHT_Z = j.value("TABLE_HEIGHT_Z", 0.0);
+        c.ACTUATION_DELAY_MS = j.value("ACTUATION_DELAY_MS", 40.0f);
+        c.PREDICTION_SERVICE_RATE_HZ = j.value("PREDICTION_SERVICE_RATE_HZ", 500.0f);
     }
 };
 
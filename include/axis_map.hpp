@@ -0,0 +1,38 @@
+#ifndef AXIS_MAP_HPP
+#define AXIS_MAP_HPP
+#include <opencv2/opencv.hpp>
+
+// Signed axis permutation with an offset: out[i] = offset[i] + sign[i] * in[axis[i]].
+// Every table orientation (defense zone side, robot origin corner) is one of these, chosen
+// once at setup, so the rules that depend on it are written once in a canonical frame.
+struct AxisMap {
+    int axis[2] = {0, 1};
+    float sign[2] = {1.0f, 1.0f};
+    float offset[2] = {0.0f, 0.0f};
+
+    AxisMap() {}
+    AxisMap(int axis0, float sign0, float offset0, int axis1, float sign1, float offset1) {
+        axis[0] = axis0; sign[0] = sign0; offset[0] = offset0;
+        axis[1] = axis1; sign[1] = sign1; offset[1] = offset1;
+    }
+
+    cv::Point2f map(const cv::Point2f& p) const {
+        const float in[2] = {p.x, p.y};
+        return cv::Point2f(offset[0] + sign[0] * in[axis[0]], offset[1] + sign[1] * in[axis[1]]);
+    }
+    // Velocities and differences: no offset
+    cv::Point2f mapVector(const cv::Point2f& v) const {
+        const float in[2] = {v.x, v.y};
+        return cv::Point2f(sign[0] * in[axis[0]], sign[1] * in[axis[1]]);
+    }
+    AxisMap inverse() const {
+        AxisMap result;
+        for (int i = 0; i < 2; ++i) {
+            result.axis[axis[i]] = i;
+            result.sign[axis[i]] = sign[i];
+            result.offset[axis[i]] = -sign[i] * offset[i];
+        }
+        return result;
+    }
+};
+#endif // AXIS_MAP_HPP
@@ -6,6 +6,28 @@
 #include <vector>
 #include "config.hpp"
 
+// Blob that passed the area, circularity and region filters; score = circularity * area
+struct BlobCandidate {
+    cv::Point2f center;
+    double score;
+};
+
+// Per-frame capture metadata. Rolling-shutter sensors read rows out one line time
+// apart, so a point's exposure time depends on the sensor row it was imaged on.
+struct FrameMetadata {
+    uint64_t timestampUs = 0;  // time the frame was returned by the camera (last row read out)
+    int sensorRows = 0;        // rows in the raw sensor frame
+    int rowOffset = 0;         // sensor row of row 0 in the cropped frame
+    double lineTimeUs = 0.0;   // sensor line readout time (0 = global shutter)
+
+    // Exposure timestamp of a row in the cropped frame
+    uint64_t rowTimestampUs(float row) const {
+        double rowsAfter = (sensorRows - 1) - (rowOffset + row);
+        if (rowsAfter <= 0.0) return timestampUs;
+        return timestampUs - (uint64_t)(rowsAfter * lineTimeUs);
+    }
+};
+
 class ImageCapture {
 public:
     ImageCapture(const Config& config);
@@ -13,10 +35,15 @@ public:
     cv::RotatedRect detectTable(cv::Mat& image);
     bool initialize();
     cv::Mat captureImage();
+    bool grabFrame();
     cv::Mat captureRawImage();
     cv::Mat captureGrayscaleImage();
     bool saveImage(const cv::Mat& image, const std::string& filename);
     cv::Point2f detectPuck(const cv::Mat& grayImage);
+    // searchRegion: the opponent's half in image pixels, so our own paddle is never picked up
+    cv::Point2f detectMallet(const cv::Mat& grayImage, cv::Point2f puckCenter, const cv::Rect& searchRegion);
+    // Every puck-like blob, best score first (the first one is what detectPuck returns)
+    void detectPuckCandidates(const cv::Mat& grayImage, std::vector<cv::Point2f>& candidates, size_t maxCandidates = 8);
     cv::Point2f imageToTableCoordinates(cv::Point2f imagePoint, int imageWidth, int imageHeight);
     cv::Point2f TableToImageCoordinates(cv::Point2f tablePoint, int imageWidth, int imageHeight);
     bool loadCalibration(const std::string& filename = "calibration_result.yaml");
@@ -25,10 +52,14 @@ public:
     bool loadCachedPerspective(const std::string& filename = "table_perspective.yml");
     int getCroppedWidth() const { return croppedWidth_; }
     int getCroppedHeight() const { return croppedHeight_; }
+    const FrameMetadata& getFrameMetadata() const { return frameMetadata_; }
     void tableFound(bool found);
     
 
 private:
+    cv::Point2f detectBlob(const cv::Mat& grayImage, int threshold, int minArea, int maxArea, const cv::Rect& searchRegion, cv::Point2f excludeCenter, float excludeRadius);
+    void collectBlobs(const cv::Mat& grayImage, int threshold, int minArea, int maxArea, const cv::Rect& searchRegion, cv::Point2f excludeCenter, float excludeRadius, std::vector<BlobCandidate>& blobs);
+
     int croppedWidth_;
     int croppedHeight_;
     cv::VideoCapture cap_;
@@ -44,6 +75,8 @@ private:
     cv::Mat tablePerspectiveMatrix_;
     cv::Rect tableBoundingRect_;
     cv::Size tableOutputSize_;
+
+    FrameMetadata frameMetadata_;
     
     const Config& config_;
 };
@@ -23,9 +23,10 @@ struct DebugRenderParams {
     double velocityConfidence;
     double fps;
     uint64_t currentTimeUs;
+    uint64_t predictedEntryTimeUs;  // 0 if unknown
     int& debugImageIndex;
     ImageCapture& capture;
-    TrajectoryPredictor& predictor;
+    PredictorSnapshot snapshot;  // predictor state the image is drawn from
 };
 
 class GameController {
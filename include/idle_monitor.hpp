@@ -0,0 +1,36 @@
+#ifndef IDLE_MONITOR_HPP
+#define IDLE_MONITOR_HPP
+#include <opencv2/opencv.hpp>
+#include "config.hpp"
+
+// Idle state machine for the control loop. After IDLE_TIMEOUT_S without puck motion
+// only every k-th frame is looked at, using a cheap downsampled frame difference;
+// the first frame with motion switches straight back to full-rate processing.
+class IdleMonitor {
+public:
+    IdleMonitor(const Config& config);
+    void observePuck(const cv::Point2f& tablePos, bool detected, uint64_t timestampUs);
+    bool isIdle() const { return idle_; }
+    bool shouldCheckFrame();
+    bool detectMotion(const cv::Mat& frame, uint64_t timestampUs);
+    void completeWake(uint64_t timestampUs);
+
+private:
+    void enterIdle();
+
+    const Config& config_;
+    bool idle_;
+    uint64_t lastActivityUs_;
+    cv::Point2f anchorPos_;
+    bool anchorValid_;
+    int frameCounter_;
+    int skippedFrames_;
+    uint64_t lastCheckUs_;
+    cv::Mat reference_;
+    cv::Mat small_;
+    cv::Mat diff_;
+    bool wakePending_;
+    uint64_t wakeFrameUs_;
+    uint64_t wakeCheckGapUs_;
+};
+#endif // IDLE_MONITOR_HPP
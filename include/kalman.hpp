@@ -3,24 +3,69 @@
 
 #include <eigen3/Eigen/Dense>
 
-class KalmanFilter {
+// Linear Kalman filter on fixed-size Eigen types, so predict/update never touch the heap.
+// State layout is [positions..., velocities...]; the first MeasDim entries are measured.
+// Scalar may be float: a 4-state float filter fits one SSE/NEON register per row.
+template <int StateDim, int MeasDim, typename Scalar = double>
+class KalmanFilterT {
 public:
-    KalmanFilter();
+    typedef Scalar ScalarType;
+    typedef Eigen::Matrix<Scalar, StateDim, 1> StateVector;
+    typedef Eigen::Matrix<Scalar, StateDim, StateDim> StateMatrix;
+    typedef Eigen::Matrix<Scalar, MeasDim, 1> MeasVector;
+    typedef Eigen::Matrix<Scalar, MeasDim, MeasDim> MeasMatrix;
+    typedef Eigen::Matrix<Scalar, MeasDim, StateDim> MeasModel;
+    typedef Eigen::Matrix<Scalar, StateDim, MeasDim> GainMatrix;
+
+    KalmanFilterT();
     void predict();
-    void update(const Eigen::VectorXd& measurement);
-    Eigen::VectorXd getState() const;
-    void setState(const Eigen::VectorXd& state);
-    void setF(const Eigen::MatrixXd& F);
+    void update(const MeasVector& measurement, double noiseScale = 1.0);
+    double mahalanobis(const MeasVector& measurement) const;
+    const StateVector& getState() const { return state_; }
+    void setState(const StateVector& state) { state_ = state; }
+    void setF(const StateMatrix& F) { F_ = F; }
+    const StateMatrix& getTransition() const { return F_; }
+    void setTransition(double dt, double velocityDecay = 0.0);
+    void reflect(int axis, double wall, double restitution = 1.0);
     void reset();
-    Eigen::MatrixXd getCovariance() const; 
+    const StateMatrix& getCovariance() const { return P_; }
+    void setCovariance(const StateMatrix& P) { P_ = P; }
+    const StateMatrix& getProcessNoise() const { return Q_; }
+    void setProcessNoise(const StateMatrix& Q) { Q_ = Q; }
+    const MeasMatrix& getMeasurementNoise() const { return R_; }
+    void setMeasurementNoise(const MeasMatrix& R) { R_ = R; }
+    // Diagonal noise variances (process noise per prediction step). Unlike setProcessNoise
+    // these are kept by reset().
+    void setNoise(double positionVariance, double velocityVariance, double measurementVariance);
+
+    // Innovation of the last update and its covariance
+    const MeasVector& getInnovation() const { return innovation_; }
+    const MeasMatrix& getInnovationCovariance() const { return innovationCov_; }
+    double getLogLikelihood() const;
 
 private:
-    Eigen::VectorXd state_;
-    Eigen::MatrixXd P_;  // Covariance
-    Eigen::MatrixXd F_;  // State transition
-    Eigen::MatrixXd H_;  // Measurement matrix
-    Eigen::MatrixXd Q_;  // Process noise
-    Eigen::MatrixXd R_;  // Measurement noise
+    static MeasMatrix invert(const MeasMatrix& S);
+
+    StateVector state_;
+    StateMatrix P_;  // Covariance
+    StateMatrix F_;  // State transition
+    MeasModel H_;    // Measurement matrix
+    StateMatrix Q_;  // Process noise
+    StateMatrix configuredQ_;  // Process noise restored by reset()
+    MeasMatrix R_;   // Measurement noise
+    MeasVector innovation_;
+    MeasMatrix innovationCov_;
 };
 
-#endif // KALMAN_HPP
\ No newline at end of file
+extern template class KalmanFilterT<4, 2, double>;
+extern template class KalmanFilterT<4, 2, float>;
+
+// Constant-velocity puck filter: state [x, y, vx, vy], measurement [x, y].
+// Built in single precision with -DKALMAN_SINGLE_PRECISION=ON.
+#ifdef KALMAN_SINGLE_PRECISION
+typedef KalmanFilterT<4, 2, float> KalmanFilter;
+#else
+typedef KalmanFilterT<4, 2, double> KalmanFilter;
+#endif
+
+#endif // KALMAN_HPP
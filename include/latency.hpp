@@ -0,0 +1,40 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+#include <cstdint>
+#include <ostream>
+#include "config.hpp"
+
+// Pipeline stages timed from the frame's capture timestamp up to the UDP send
+enum LatencyStage {
+    STAGE_DETECT = 0,   // capture timestamp -> puck detected
+    STAGE_PREDICT = 1,  // detection -> filter updated and entry predicted
+    STAGE_SEND = 2,     // prediction -> move command sent
+    STAGE_COUNT = 3
+};
+
+// Tracks per-stage latency of the vision-to-robot pipeline and, with the configured
+// actuation delay, the time at which a command issued now actually moves the robot
+class LatencyTracker {
+public:
+    LatencyTracker(const Config& config);
+    void beginFrame(uint64_t captureTimestampUs);
+    void mark(LatencyStage stage);
+    // Stage timed elsewhere (the prediction service's sends)
+    void record(LatencyStage stage, double elapsedUs);
+    uint64_t actionTimestamp() const;
+    double getStageMeanUs(LatencyStage stage) const { return stageMeanUs_[stage]; }
+    double getStageMaxUs(LatencyStage stage) const { return stageMaxUs_[stage]; }
+    double getCaptureToActionUs() const;
+    void print(std::ostream& out) const;
+
+    static uint64_t nowUs();
+
+private:
+    const Config& config_;
+    uint64_t frameTimestampUs_;
+    uint64_t lastMarkUs_;
+    double stageMeanUs_[STAGE_COUNT];  // exponential moving average
+    double stageMaxUs_[STAGE_COUNT];
+    bool stageSeen_[STAGE_COUNT];
+};
+#endif // LATENCY_HPP
@@ -0,0 +1,70 @@
+#ifndef LINE_FIT_HPP
+#define LINE_FIT_HPP
+#include <opencv2/opencv.hpp>
+#include "kalman.hpp"
+#include "config.hpp"
+
+// Alternative to the Kalman filter for the straight legs of the puck path: the detections
+// of the current leg are kept in a ring of the last LINE_FIT_WINDOW samples and fitted with
+// a RANSAC line, so a single bad detection never bends the velocity. A leg ends at a wall
+// contact predicted by the fit (the next leg starts from the reflected fit) or when two
+// detections in a row leave it (a hit).
+class LineFitEstimator {
+public:
+    static const int MAX_WINDOW = 64;
+
+    LineFitEstimator(const Config& config);
+    // Returns true when the estimate was updated with this measurement
+    bool addMeasurement(const cv::Point2f& position, uint64_t timestamp);
+    void reset();
+    bool hasEstimate() const { return hasEstimate_; }
+    // Position and velocity at the last accepted measurement, and their covariance
+    const KalmanFilter::StateVector& getState() const { return state_; }
+    const KalmanFilter::StateMatrix& getCovariance() const { return covariance_; }
+    uint64_t getTimestamp() const { return timestamp_; }
+    int getSampleCount() const { return size_; }
+    int getInlierCount() const { return inliers_; }
+    int getSegmentCount() const { return segments_; }  // legs started since the last reset
+
+private:
+    struct Sample {
+        cv::Point2f position;
+        uint64_t timestamp;
+    };
+
+    // Sample i of the current leg, 0 = oldest
+    const Sample& sample(int i) const { return ring_[(end_ - size_ + i + MAX_WINDOW) % MAX_WINDOW]; }
+    int window() const;
+    void push(const Sample& s);
+    void startSegment();
+    void fit();
+    bool reflectAtWall(const cv::Point2f& position, uint64_t timestamp);
+
+    const Config* config_;  // pointer so the estimator stays copyable (out-of-sequence replay history)
+    Sample ring_[MAX_WINDOW];
+    int end_;     // next slot to write
+    int stored_;  // samples in the ring
+    int size_;    // samples of the current leg, the newest ones in the ring
+    Sample pending_;  // first sample off the fit, confirmed as a new leg by the next one
+    bool hasPending_;
+
+    // Leg before the last hit, restored if the next sample is back on its line
+    bool canRevert_;
+    KalmanFilter::StateVector revertState_;
+    uint64_t revertTimestamp_;
+    int revertSize_;
+
+    // Velocity carried over a bounce, used until the new leg has enough samples for a line
+    bool hasCarriedVelocity_;
+    cv::Point2f carriedVelocity_;
+    double carriedVelocityVar_;
+
+    bool hasEstimate_;
+    KalmanFilter::StateVector state_;
+    KalmanFilter::StateMatrix covariance_;
+    uint64_t timestamp_;
+    int inliers_;
+    int segments_;
+    uint32_t random_;  // LCG state for the RANSAC hypotheses
+};
+#endif // LINE_FIT_HPP
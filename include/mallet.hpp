@@ -0,0 +1,35 @@
+#ifndef MALLET_HPP
+#define MALLET_HPP
+#include <opencv2/opencv.hpp>
+#include "config.hpp"
+
+// Predicted mallet-puck contact and the puck motion right after it
+struct ContactPrediction {
+    bool valid = false;
+    double timeToContact = 0.0;    // seconds from the query time
+    cv::Point2f puckAtContact;     // puck center at contact (mm)
+    cv::Point2f outgoingVelocity;  // puck velocity right after the hit (mm/s)
+};
+
+// Tracks the opponent mallet with a lightweight alpha-beta filter
+class MalletTracker {
+public:
+    MalletTracker(const Config& config);
+    void addMeasurement(const cv::Point2f& position, uint64_t timestamp);
+    void markMissing();
+    void reset();
+    bool isTracking() const { return tracking_; }
+    cv::Point2f predictPosition(uint64_t futureTimestamp) const;
+    cv::Point2f getVelocity() const { return velocity_; }
+    ContactPrediction predictContact(const cv::Point2f& puckPos, const cv::Point2f& puckVel, uint64_t timestamp) const;
+
+private:
+    const Config& config_;
+    cv::Point2f position_;
+    cv::Point2f velocity_;
+    uint64_t lastTimestamp_;
+    int measurements_;
+    int missedFrames_;
+    bool tracking_;
+};
+#endif // MALLET_HPP
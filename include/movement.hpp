@@ -2,8 +2,10 @@
 #define MOVEMENT_HPP
 //tcp communication with abb robot
 #include "config.hpp"
+#include "axis_map.hpp"
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <mutex>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -25,11 +27,16 @@ public:
     bool moveTo(cv::Point2f tablePosition);
     void stop();
     cv::Point2f TableToRobotCoordinates(cv::Point2f tablePosition);
+    // Robot frame for an origin corner (0 = top left, 1 = top right, 2 = bottom left, 3 = bottom
+    // right); set from robot_origin_corner at construction
+    void setOriginCorner(int corner);
     bool sendRawData(const void* data, size_t size);
 
 private:
     cv::Point2f lastPosition;
     const Config& config_;
+    AxisMap robotFromTable_;
+    std::mutex commandMutex_;  // moveTo/stop are called from the camera loop and the prediction service
 #ifdef _WIN32
     SOCKET robotSocket;
 #else
@@ -0,0 +1,92 @@
+#ifndef MULTI_TRACKER_HPP
+#define MULTI_TRACKER_HPP
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "kalman.hpp"
+#include "config.hpp"
+
+// Snapshot of one track, in table coordinates (mm)
+struct TrackState {
+    int id = -1;
+    cv::Point2f position;
+    cv::Point2f velocity;       // mm/s
+    cv::Point2f positionStd;    // mm
+    int hits = 0;               // updates since birth
+    int misses = 0;             // frames since the last update
+    bool confirmed = false;
+};
+
+// Tracks several objects at once (pucks, mallets) with one constant-velocity filter per
+// track. States and covariances are stored as structure-of-arrays, one array per element,
+// so prediction, gating and the update run as single loops across all tracks that the
+// compiler vectorizes. Detections are assigned to tracks with the Hungarian algorithm on
+// the Mahalanobis distance; unassigned detections restart a nearby confirmed track that
+// lost its gate or start a tentative track, and tracks that stop receiving detections
+// are dropped.
+class MultiTargetTracker {
+public:
+    typedef KalmanFilter::ScalarType Scalar;
+    static const int MAX_TRACKS = 16;
+    static const int MAX_DETECTIONS = 16;  // further detections in a frame are ignored
+
+    MultiTargetTracker(const Config& config);
+    // One frame: predicts every track to the timestamp, associates the detections (table mm,
+    // best first) and updates, drops and creates tracks
+    void update(const std::vector<cv::Point2f>& detections, uint64_t timestamp);
+    void reset();
+    int getTrackCount() const { return count_; }
+    TrackState getTrack(int index) const;
+    int findTrack(int id) const;  // index of the track with this id, -1 if none
+    cv::Point2f predictPosition(int index, uint64_t futureTimestamp) const;
+    // Track id each detection of the last frame went to, new tracks included (-1 = tracker full)
+    const std::vector<int>& getAssignedIds() const { return assignedIds_; }
+
+private:
+    void predict(Scalar dt);
+    void correct();
+    void associate(const std::vector<cv::Point2f>& detections, int detectionCount);
+    void reacquire(const std::vector<cv::Point2f>& detections, int detectionCount);
+    void removeTrack(int index);
+    void addTrack(const cv::Point2f& position);
+    void initTrack(int index, const cv::Point2f& position);
+
+    const Config& config_;
+    int count_;
+    int nextId_;
+    uint64_t lastTimestamp_;
+
+    // Track state, one entry per track
+    alignas(32) Scalar x_[MAX_TRACKS];
+    alignas(32) Scalar y_[MAX_TRACKS];
+    alignas(32) Scalar vx_[MAX_TRACKS];
+    alignas(32) Scalar vy_[MAX_TRACKS];
+    // Upper triangle of the symmetric covariance, in state order x, y, vx, vy
+    alignas(32) Scalar pxx_[MAX_TRACKS];
+    alignas(32) Scalar pxy_[MAX_TRACKS];
+    alignas(32) Scalar pxvx_[MAX_TRACKS];
+    alignas(32) Scalar pxvy_[MAX_TRACKS];
+    alignas(32) Scalar pyy_[MAX_TRACKS];
+    alignas(32) Scalar pyvx_[MAX_TRACKS];
+    alignas(32) Scalar pyvy_[MAX_TRACKS];
+    alignas(32) Scalar pvxvx_[MAX_TRACKS];
+    alignas(32) Scalar pvxvy_[MAX_TRACKS];
+    alignas(32) Scalar pvyvy_[MAX_TRACKS];
+    // Inverse innovation covariance after the prediction, used for gating and the gain
+    alignas(32) Scalar sxx_[MAX_TRACKS];
+    alignas(32) Scalar sxy_[MAX_TRACKS];
+    alignas(32) Scalar syy_[MAX_TRACKS];
+    // Assigned measurement; weight 0 leaves the track unchanged
+    alignas(32) Scalar mx_[MAX_TRACKS];
+    alignas(32) Scalar my_[MAX_TRACKS];
+    alignas(32) Scalar weight_[MAX_TRACKS];
+
+    int id_[MAX_TRACKS];
+    int hits_[MAX_TRACKS];
+    int misses_[MAX_TRACKS];
+
+    // Association scratch space, kept to avoid per-frame allocation
+    std::vector<double> cost_;
+    std::vector<int> assignment_;
+    std::vector<int> assignedIds_;
+};
+#endif // MULTI_TRACKER_HPP
@@ -0,0 +1,64 @@
+#ifndef PHYSICS_ESTIMATOR_HPP
+#define PHYSICS_ESTIMATOR_HPP
+#include <opencv2/opencv.hpp>
+#include "trajectory.hpp"
+#include "config.hpp"
+
+// Least-squares fit of one straight leg of the puck path: position against time, quadratic
+// per axis, accumulated as running sums so a sample costs a few multiply-adds
+struct LegFit {
+    uint64_t t0 = 0;  // first sample (us)
+    int count = 0;
+    double duration = 0.0;  // seconds from the first to the last sample
+    double sumT[5] = {0, 0, 0, 0, 0};  // sum of t^k
+    double sumX[3] = {0, 0, 0};        // sum of x * t^k
+    double sumY[3] = {0, 0, 0};
+
+    void add(const PuckPosition& sample);
+    // Linear fit: position and velocity at t seconds after t0
+    bool linear(double t, cv::Point2f& position, cv::Point2f& velocity) const;
+    // Quadratic fit: position, velocity and acceleration at t seconds after t0
+    bool quadratic(double t, cv::Point2f& position, cv::Point2f& velocity, cv::Point2f& acceleration) const;
+};
+
+// Identifies the table physics used by the predictor during play: the restitution of each
+// wall from tracked bounces and the glide decay from long free glides. Measurements are
+// split into legs at predicted wall contacts and wherever the path leaves the current fit
+// (mallet hits); two legs joined at a wall give one bounce sample.
+class PhysicsEstimator {
+public:
+    PhysicsEstimator(const Config& config);
+    // Returns true when the measurement completed a new bounce or glide sample
+    bool addMeasurement(const PuckPosition& measurement);
+    void reset();
+    // Writes every estimate with at least PHYSICS_MIN_SAMPLES samples to its own file, to be
+    // reviewed and copied into config.json; returns false when there is none
+    bool saveEstimates(const std::string& filename) const;
+    int getBounceCount(int wall) const { return bounceCount_[wall]; }
+    double getRestitution(int wall) const;
+    int getGlideCount() const { return glideCount_; }
+    double getGlideDecay() const;
+    void print(std::ostream& out) const;
+
+private:
+    bool closeLeg(int wall, double hitTime);
+    bool sampleBounce();
+
+    const Config& config_;
+    LegFit leg_;
+    PuckPosition last_;
+    PuckPosition pending_;  // first sample off the current fit, confirmed by the next one
+    bool hasPending_;
+
+    // Leg that ended at a wall, waiting for enough samples of the next leg
+    LegFit incoming_;
+    int incomingWall_;   // -1 when none
+    double incomingHit_;  // contact time, seconds after incoming_.t0
+
+    double restitutionSum_[4];
+    int bounceCount_[4];
+    double decaySum_;
+    double decayWeight_;
+    int glideCount_;
+};
+#endif // PHYSICS_ESTIMATOR_HPP
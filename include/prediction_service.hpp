@@ -0,0 +1,73 @@
+#ifndef PREDICTION_SERVICE_HPP
+#define PREDICTION_SERVICE_HPP
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "trajectory.hpp"
+#include "movement.hpp"
+#include "config.hpp"
+
+struct PredictionServiceStatistics {
+    uint64_t ticks = 0;
+    uint64_t commands = 0;      // targets sent to the robot
+    uint64_t overruns = 0;      // ticks started more than a period late (schedule reset)
+    double maxLatenessUs = 0.0; // worst wake-up delay behind the schedule
+    double maxHoldUs = 0.0;     // longest a snapshot waited for the checks before it was sent
+};
+
+// Move sent by the service, handed to the camera loop for logging, recording and rendering
+struct PredictionServiceCommand {
+    cv::Point2f tableTarget;  // hedged entry from the snapshot (or the pre-position request)
+    cv::Point2f robotTarget;
+    double sendLatencyUs = 0.0;  // tick that decided to send -> sendto
+    double holdUs = 0.0;         // snapshot publication (or pre-position request) -> that tick
+    bool prePosition = false;    // requested by the camera loop, not the predicted entry
+};
+
+// Sends the defense moves on its own timer instead of once per camera frame. A thread wakes
+// at PREDICTION_SERVICE_RATE_HZ, reads the predictor's latest snapshot, propagates it to the
+// time a command sent now takes effect (ACTUATION_DELAY_MS) and sends the hedged entry as
+// soon as the puck there passes the same checks the camera loop uses. Each snapshot is sent
+// at most once; the checks are re-evaluated every tick as the puck moves along its path.
+// While it runs it is the only sender of moves: pre-positioning targets from the camera loop
+// go through requestPrePosition().
+class PredictionService {
+public:
+    static constexpr double MIN_SPEED_FOR_ROBOT_MM_S = 100.0;
+    static constexpr double DEFENSE_ZONE_BUFFER_MM = 100.0;  // no new moves this close to the zone
+
+    PredictionService(const Config& config, const TrajectoryPredictor& predictor, MovementController& mover);
+    ~PredictionService();
+    void start();
+    void stop();
+    bool isRunning() const { return thread_.joinable(); }
+    // Newest move sent since the last call (for logging, session records and debug images)
+    bool takeCommand(PredictionServiceCommand& command);
+    // Table position to move to while the predictor has no entry (mallet hit anticipation);
+    // sent once by the next tick, and dropped when an entry appears first
+    void requestPrePosition(const cv::Point2f& tableTarget);
+    PredictionServiceStatistics getStatistics() const;
+
+private:
+    void run();
+    void tick(uint64_t nowUs);
+    void send(const cv::Point2f& tableTarget, uint64_t nowUs, uint64_t sinceUs, bool prePosition);
+
+    const Config& config_;
+    const TrajectoryPredictor& predictor_;
+    MovementController& mover_;
+    std::thread thread_;
+    std::atomic<bool> stopping_;
+
+    uint64_t lastAttemptVersion_;  // snapshot last sent (or refused by the robot)
+
+    mutable std::mutex mutex_;  // guards the members below
+    PredictionServiceStatistics stats_;
+    bool hasCommand_;
+    PredictionServiceCommand command_;
+    bool hasPrePosition_;
+    cv::Point2f prePositionTarget_;
+    uint64_t prePositionRequestUs_;
+};
+#endif // PREDICTION_SERVICE_HPP
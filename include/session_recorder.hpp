@@ -0,0 +1,96 @@
+#ifndef SESSION_RECORDER_HPP
+#define SESSION_RECORDER_HPP
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.hpp"
+
+// Compact session log. The static table background is stored once, then every frame
+// only keeps a small grayscale patch around each detection plus its metadata.
+// A full keyframe is stored every SESSION_KEYFRAME_INTERVAL frames.
+//
+// File layout: "AHRS" magic, uint32 version, then chunks of [uint8 type][uint32 size][payload]:
+//   'B' background  : uint64 timestamp, PNG bytes
+//   'K' keyframe    : uint64 timestamp, JPEG bytes (follows the 'F' chunk of the same frame)
+//   'F' frame       : see SessionRecorder::recordFrame
+
+enum SessionDetectionKind : uint8_t {
+    SESSION_DETECTION_PUCK = 0,
+    SESSION_DETECTION_MALLET = 1
+};
+
+struct SessionDetection {
+    uint8_t kind;
+    uint64_t timestampUs;  // row exposure time
+    cv::Point2f image;     // px in the cropped frame
+    cv::Point2f table;     // mm
+    cv::Rect patchRect;    // filled in by the recorder
+};
+
+struct SessionFrameRecord {
+    uint64_t timestampUs = 0;
+    std::vector<SessionDetection> detections;
+    bool filterValid = false;
+    double filterState[4] = {0, 0, 0, 0};  // x, y, vx, vy
+    double filterCovariance[16] = {0};     // row-major 4x4
+    bool commandSent = false;
+    cv::Point2f commandTarget;
+};
+
+class SessionRecorder {
+public:
+    SessionRecorder(const Config& config);
+    ~SessionRecorder();
+    bool open(const std::string& filename, const cv::Mat& background);
+    void recordFrame(const cv::Mat& grayFrame, SessionFrameRecord& record);
+    void close();
+    bool isOpen() const { return file_ != nullptr; }
+    uint64_t getRecordedFrames() const { return recordedFrames_; }
+    uint64_t getDroppedFrames() const { return droppedFrames_; }
+
+private:
+    template <typename T> void put(const T& value);
+    void putBytes(const void* data, size_t size);
+    bool reserve(size_t size);
+    void writerLoop();
+    void writeBuffer(const std::vector<uint8_t>& buffer, size_t used);
+
+    const Config& config_;
+    FILE* file_;
+
+    // Double-buffered streaming writes: the loop fills one preallocated buffer
+    // while the writer thread flushes the other
+    std::vector<uint8_t> buffers_[2];
+    size_t used_[2];
+    int active_;
+    int pending_;
+    bool stopping_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread writer_;
+
+    uint64_t recordedFrames_;
+    uint64_t droppedFrames_;
+    uint64_t framesSinceKeyframe_;
+};
+
+class SessionReader {
+public:
+    ~SessionReader() { close(); }
+    bool open(const std::string& filename);
+    bool next(SessionFrameRecord& record, cv::Mat& frame);
+    void close();
+
+private:
+    bool readChunk(uint8_t& type, std::vector<uint8_t>& payload);
+
+    FILE* file_ = nullptr;
+    cv::Mat background_;
+    std::vector<uint8_t> payload_;
+};
+#endif // SESSION_RECORDER_HPP
@@ -0,0 +1,39 @@
+#ifndef SMOOTHER_HPP
+#define SMOOTHER_HPP
+#include <vector>
+#include "trajectory.hpp"
+
+struct SmoothedState {
+    uint64_t timestamp;
+    cv::Point2f measurement;             // mm, as recorded
+    KalmanFilter::StateVector state;     // x, y, vx, vy
+    KalmanFilter::StateMatrix covariance;
+    KalmanFilter::StateMatrix transition;       // from the previous state of the track (identity at its start)
+    KalmanFilter::StateMatrix crossCovariance;  // with the previous state, full RTS (lag 0) only
+    bool rejected;  // measurement beyond GATE_REJECT_CHI2 of the forward prediction, not used
+    int track;      // contiguous track index, a new one starts after a detection gap or a run of rejections
+};
+
+// Offline Rauch-Tung-Striebel smoother for recorded puck measurements. The forward pass
+// runs the live constant-velocity filter with the same bounce-aware propagation, the
+// backward pass then corrects every state with the measurements that came after it.
+// lag = 0 smooths over the whole track, lag > 0 only looks `lag` measurements ahead.
+class TrackSmoother {
+public:
+    TrackSmoother(const Config& config);
+    void smooth(const std::vector<PuckPosition>& measurements, std::vector<SmoothedState>& states, int lag = 0);
+
+private:
+    void smoothBackward(size_t first, size_t last, std::vector<SmoothedState>& states, int lag) const;
+
+    const Config& config_;
+    TrajectoryPredictor walls_;  // collision model only
+
+    // Forward pass, indexed like the output states
+    std::vector<KalmanFilter::StateVector> predictedState_;
+    std::vector<KalmanFilter::StateMatrix> predictedCov_;
+    std::vector<KalmanFilter::StateMatrix> transition_;  // from the previous state
+    std::vector<KalmanFilter::StateVector> filteredState_;
+    std::vector<KalmanFilter::StateMatrix> filteredCov_;
+};
+#endif // SMOOTHER_HPP
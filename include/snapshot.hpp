@@ -0,0 +1,55 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Publishes copies of a plain struct from one writer thread to any number of readers (seqlock).
+// The writer never waits for readers; a reader copies the latest value and retries when a
+// publish overlapped its copy. The value is stored as words in relaxed atomics, so readers
+// racing the writer are well defined and only ever return a complete, consistent value.
+template <typename T>
+class SnapshotPublisher {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots are copied word by word");
+
+public:
+    SnapshotPublisher() : sequence_(0) {
+        for (size_t i = 0; i < WORDS; ++i) words_[i].store(0, std::memory_order_relaxed);
+        publish(T());
+    }
+
+    // Single writer only
+    void publish(const T& value) {
+        uint64_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);  // odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) words_[i].store(buffer[i], std::memory_order_relaxed);
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Copies the latest value and returns its version (publishes so far, the initial one included)
+    uint64_t read(T& value) const {
+        uint64_t buffer[WORDS];
+        for (;;) {
+            uint64_t before = sequence_.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            for (size_t i = 0; i < WORDS; ++i) buffer[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) {
+                std::memcpy(&value, buffer, sizeof(T));
+                return before / 2;
+            }
+        }
+    }
+
+    uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    std::atomic<uint64_t> sequence_;
+    std::atomic<uint64_t> words_[WORDS];
+};
+#endif // SNAPSHOT_HPP
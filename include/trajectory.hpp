@@ -3,19 +3,163 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include "kalman.hpp"
+#include "line_fit.hpp"
+#include "snapshot.hpp"
+#include "axis_map.hpp"
 #include "config.hpp"
 
+// Motion models run in parallel by the IMM estimator
+enum MotionModel {
+    MODEL_CONSTANT_VELOCITY = 0,  // free glide
+    MODEL_FRICTION = 1,           // decelerating glide
+    MODEL_MANEUVER = 2,           // bounces and hits (high process noise)
+    MODEL_COUNT = 3
+};
+
+// State estimator behind the predictions
+enum TrajectoryEstimator {
+    ESTIMATOR_KALMAN = 0,    // Kalman filter, IMM when enabled
+    ESTIMATOR_LINE_FIT = 1   // RANSAC line fit over the current leg (LineFitEstimator)
+};
+
 struct PuckPosition {
     cv::Point2f position;  // mm
     uint64_t timestamp;    
 };
 
+// Outcome of the innovation gate for one measurement
+enum GateResult {
+    GATE_ACCEPTED = 0,
+    GATE_DOWNWEIGHTED = 1,   // beyond GATE_CHI2, used with inflated measurement noise
+    GATE_REJECTED = 2,       // beyond GATE_REJECT_CHI2, ignored
+    GATE_REINITIALIZED = 3   // too many rejections in a row, track restarted from it
+};
+
+struct GateStatistics {
+    uint64_t accepted = 0;
+    uint64_t downweighted = 0;
+    uint64_t rejected = 0;
+    uint64_t reinitialized = 0;
+    int consecutiveRejects = 0;
+    double lastDistance = 0.0;  // squared Mahalanobis distance of the last measurement
+    GateResult lastResult = GATE_ACCEPTED;
+};
+
+// Discrete changes of the puck motion, found as two innovations in a row beyond EVENT_CHI2
+// pointing the same way. The filter restarts its velocity from the detections after the event.
+enum TrajectoryEventType {
+    EVENT_NONE = 0,
+    EVENT_BOUNCE = 1,  // wall contact the bounce model got wrong (restitution, spin)
+    EVENT_HIT = 2,     // mallet or paddle hit
+    EVENT_STOP = 3     // puck stopped or caught
+};
+
+struct TrajectoryEvent {
+    TrajectoryEventType type = EVENT_NONE;
+    uint64_t timestamp = 0;       // first detection after the event (us)
+    cv::Point2f position;         // mm, at that detection
+    cv::Point2f velocityBefore;   // mm/s, filter estimate just before the event
+    cv::Point2f velocityAfter;    // mm/s, restarted estimate (zero for a stop)
+    int wall = -1;                // wall of a bounce, numbered as in the collision model
+    double distance = 0.0;        // squared Mahalanobis distance of the confirming detection
+};
+
+struct EventStatistics {
+    uint64_t bounces = 0;
+    uint64_t hits = 0;
+    uint64_t stops = 0;
+    TrajectoryEvent last;
+};
+
+// Measurements that arrived out of timestamp order (several detection threads or cameras)
+struct SequenceStatistics {
+    uint64_t reordered = 0;  // applied at their own time, newer measurements replayed after them
+    uint64_t dropped = 0;    // older than the history or a repeated timestamp
+};
+
+// Predicted path between measurements: straight segments between wall bounces, ending in
+// a resting segment at the last bounce considered or at the wall opposite the defense zone.
+// The speed decays by GLIDE_DECAY along every segment.
+struct TrajectorySegment {
+    double t0;             // seconds after the state time
+    cv::Point2f start;     // mm
+    cv::Point2f velocity;  // mm/s
+};
+
+struct TrajectorySegments {
+    static const int MAX_SEGMENTS = 4;
+    int count = 0;
+    double decay = 0.0;  // velocity decay rate (1/s)
+    TrajectorySegment segments[MAX_SEGMENTS];
+
+    int find(double t) const;  // segment covering t (binary search)
+    cv::Point2f position(double t) const;
+    cv::Point2f velocity(double t) const;
+};
+
+// Where, when and how the puck reaches the defense zone
+struct EntryPrediction {
+    bool valid = false;
+    cv::Point2f point;       // mm
+    cv::Point2f velocity;    // mm/s at entry
+    double timeS = 0.0;      // seconds after the state it was solved from
+    uint64_t timestamp = 0;  // absolute entry time (us), set by predictEntry()
+    int bounces = 0;         // wall bounces before entry
+};
+
+// Entry spread from propagating the filter covariance through the bounce model (sigma points)
+struct EntryDistribution {
+    bool valid = false;
+    cv::Point2f mean;          // mm
+    double lateralStd = 0.0;   // spread along the goal line (mm)
+    double timeS = 0.0;        // mean entry time after the state time
+    double timeStdS = 0.0;
+    uint64_t timestamp = 0;    // absolute mean entry time (us)
+    double validFraction = 0.0;  // weight of the sigma points that reach the zone
+};
+
+// Copy of the predictor after its last update, published for readers on other threads
+// (renderers, loggers, the command thread). Queries give the same results as the predictor's.
+struct PredictorSnapshot {
+    uint64_t version = 0;          // publication number, set by TrajectoryPredictor::getSnapshot()
+    uint64_t publishedUs = 0;      // publication time, same clock as the frame timestamps (getTickCount)
+    bool initialized = false;
+    uint64_t timestamp = 0;        // state time (us)
+    double state[4] = {};          // x, y, vx, vy
+    double covariance[16] = {};    // row major
+    int zoneIndex = -1;
+    double zoneXMin = 0.0, zoneXMax = 0.0, zoneYMin = 0.0, zoneYMax = 0.0;
+    AxisMap zoneFrame;
+    double tableWidth = 0.0, tableHeight = 0.0;
+    TrajectorySegments trajectory;
+    EntryPrediction entry;
+    cv::Point2f target = cv::Point2f(-1, -1);  // entry hedged by its spread (hedgeEntry), when entry.valid
+
+    cv::Point2f getPosition() const { return cv::Point2f(state[0], state[1]); }
+    cv::Point2f getVelocity() const { return cv::Point2f(state[2], state[3]); }
+    cv::Point2f predictPosition(uint64_t futureTimestamp) const;
+    cv::Point2f predictVelocity(uint64_t futureTimestamp) const;
+    void predictPositions(const uint64_t* timestamps, cv::Point2f* positions, size_t count) const;
+    double getVelocityConfidence() const;
+};
+
 class TrajectoryPredictor {
 public:
+    static const int MAX_INIT_SAMPLES = 5;  // upper bound for TRACK_INIT_SAMPLES
     TrajectoryPredictor(const Config& config);
+    // Measurements may arrive out of order: one older than the newest is applied at its own
+    // time as long as it is within the last OOSM_HISTORY_LENGTH measurements
     void addMeasurement(const PuckPosition& measurement);
-    cv::Point2f predictPosition(uint64_t futureTimestamp);
+    cv::Point2f predictPosition(uint64_t futureTimestamp) const;
+    cv::Point2f predictVelocity(uint64_t futureTimestamp) const;
+    void predictPositions(const uint64_t* timestamps, cv::Point2f* positions, size_t count) const;
+    const TrajectorySegments& getTrajectory() const;
     cv::Point2f predictEntryToDefenseZone(uint64_t currentTimestamp);
+    cv::Point2f predictEntryFromState(const cv::Point2f& pos, const cv::Point2f& vel);
+    EntryPrediction predictEntry() const;
+    EntryPrediction solveEntry(const cv::Point2f& pos, const cv::Point2f& vel) const;
+    EntryDistribution predictEntryDistribution() const;
+    cv::Point2f hedgeEntry(const EntryDistribution& distribution) const;
     void reset();  
     bool isInDefenseZone(const cv::Point2f& pos);
     void setDefenseZone(int zoneIndex); 
@@ -23,13 +167,113 @@ public:
     double getDefenseZoneXMax() const { return zoneXMax; }
     double getDefenseZoneYMin() const { return zoneYMin; }
     double getDefenseZoneYMax() const { return zoneYMax; }
+    // Table to the defense zone's frame: x along the goal line, y the depth from it into the table
+    const AxisMap& getZoneFrame() const { return zoneFrame_; }
     double getVelocityConfidence();
+    bool isInitialized() const { return initialized_; }
+    // Switching the estimator restarts the track. Defaults to TRAJECTORY_ESTIMATOR.
+    void setEstimator(TrajectoryEstimator estimator);
+    TrajectoryEstimator getEstimator() const { return estimator_; }
+    const LineFitEstimator& getLineFit() const { return lineFit_; }
+    cv::Point2f getPosition() const;
+    cv::Point2f getVelocity() const;
+    const KalmanFilter::StateMatrix& getCovariance() const { return kalmanFilter_.getCovariance(); }
+    uint64_t getLastTimestamp() const { return lastTimestamp_; }
+    const Eigen::Vector3d& getModeProbabilities() const { return modeProbabilities_; }
+    int getMostLikelyModel() const;
+    const GateStatistics& getGateStatistics() const { return gateStats_; }
+    const SequenceStatistics& getSequenceStatistics() const { return sequenceStats_; }
+    const EventStatistics& getEventStatistics() const { return eventStats_; }
+    // Latest published snapshot. Safe to call from any thread while the owner keeps updating;
+    // it never blocks the owner.
+    PredictorSnapshot getSnapshot() const;
+
+    // Advances a filter by dt through any wall bounces. When transition is given it receives
+    // the combined state transition (segment transitions and reflections) for smoothing.
+    void propagate(KalmanFilter& filter, double dt, double decay, KalmanFilter::StateMatrix* transition = nullptr) const;
 private:
+    // First detection beyond EVENT_CHI2, waiting for the next one to confirm an event
+    struct EventCandidate {
+        bool valid = false;
+        PuckPosition measurement;
+        KalmanFilter::MeasVector innovation;
+        cv::Point2f velocity;  // filter estimate before it
+    };
+
+    // Everything a measurement changes, so the predictor can be rewound to an earlier one
+    struct PredictorState {
+        KalmanFilter filter;
+        KalmanFilter models[MODEL_COUNT];
+        Eigen::Vector3d modeProbabilities;
+        GateStatistics gateStats;
+        EventCandidate eventCandidate;
+        EventStatistics eventStats;
+        LineFitEstimator lineFit;
+        uint64_t lastTimestamp;
+        bool initialized;
+        PuckPosition initSamples[MAX_INIT_SAMPLES];
+        int initCount;
+        PredictorState(const Config& config) : lineFit(config), lastTimestamp(0), initialized(false), initCount(0) {}
+    };
+    struct HistoryEntry {
+        PuckPosition measurement;
+        PredictorState state;  // after the measurement
+        HistoryEntry(const Config& config) : state(config) {}
+    };
+
+    // Collision model shared by the filter and the predictions. Walls are the table edges
+    // inset by the puck radius: 0 = left (x min), 1 = right (x max), 2 = y min, 3 = y max
+    bool nextWallHit(double x, double y, double vx, double vy, double decay, double& tHit, int& wall) const;
+    void buildTrajectory() const;
+    void configureModels();
+    bool updateModels(double dt, const KalmanFilter::MeasVector& meas, KalmanFilter::MeasVector& innovation);
+    bool detectEvent(const PuckPosition& measurement, const KalmanFilter::MeasVector& innovation, const cv::Point2f& velocity);
+    void applyMeasurement(const PuckPosition& measurement);
+    void insertLateMeasurement(const PuckPosition& measurement);
+    void recordMeasurement(const PuckPosition& measurement);
+    void saveState(PredictorState& state) const;
+    void restoreState(const PredictorState& state);
+    HistoryEntry& historyAt(int i) { return history_[(historyStart_ + i) % history_.size()]; }
+    void resetTrack();
+    void publishSnapshot();
+    void seedTrack(const KalmanFilter::StateVector& state, const KalmanFilter::StateMatrix& covariance);
+    bool fitInitialTrack();
+    double gate(double distance);
+
     const Config& config_;
     int currentZoneIndex_;
     double zoneYMax, zoneYMin, zoneXMin, zoneXMax;
-    KalmanFilter kalmanFilter_;
+    AxisMap zoneFrame_;
+    int stopWall_;  // wall opposite the defense zone, -1 without a zone
+    KalmanFilter kalmanFilter_;  // combined estimate when the IMM is enabled
+    KalmanFilter models_[MODEL_COUNT];
+    Eigen::Vector3d modeProbabilities_;
+    Eigen::Matrix3d modeTransition_;  // (i, j) = P(model j now | model i before)
+    GateStatistics gateStats_;
+    EventCandidate eventCandidate_;
+    EventStatistics eventStats_;
+    TrajectoryEstimator estimator_;
+    LineFitEstimator lineFit_;
     uint64_t lastTimestamp_;
     bool initialized_;
+
+    // Detections of a new track, until the least-squares seed replaces the filter estimate
+    PuckPosition initSamples_[MAX_INIT_SAMPLES];
+    int initCount_;  // 0 once the track has been seeded
+
+    // Ring of the last OOSM_HISTORY_LENGTH measurements, oldest first
+    std::vector<HistoryEntry> history_;
+    int historyStart_;
+    int historyCount_;
+    std::vector<PuckPosition> replay_;  // measurements re-applied after a late one
+    SequenceStatistics sequenceStats_;
+
+    // Built lazily once per state update and shared by every query until the next one
+    mutable TrajectorySegments trajectory_;
+    mutable EntryPrediction entry_;
+    mutable bool trajectoryValid_;
+
+    // Republished after every update, reset and zone change
+    SnapshotPublisher<PredictorSnapshot> snapshots_;
 };
 #endif // TRAJECTORY_HPP
\ No newline at end of file
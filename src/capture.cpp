@@ -1,4 +1,5 @@
 #include "capture.hpp"
+#include <algorithm>
 #include <iostream>
 
 ImageCapture::ImageCapture(const Config& config) : config_(config), cameraIndex_(config.CAMERA_INDEX), croppedWidth_(config.TABLE_WIDTH), croppedHeight_(config.TABLE_HEIGHT), tableDetected_(false), tablePerspectiveCached_(false) {}
@@ -97,6 +98,10 @@ cv::Mat ImageCapture::captureImage() {
     cv::Mat frame;
     if (cap_.isOpened()) {
         cap_ >> frame;
+        frameMetadata_.timestampUs = (uint64_t)(cv::getTickCount() / cv::getTickFrequency() * 1000000.0);
+        frameMetadata_.sensorRows = frame.rows;
+        frameMetadata_.rowOffset = 0;
+        frameMetadata_.lineTimeUs = config_.ROLLING_SHUTTER_LINE_TIME_US;
         
         // Undistort the frame if calibration is available and enabled
         if (!cameraMatrix_.empty() && !distCoeffs_.empty() && config_.ENABLE_UNDISTORTION) {
@@ -147,11 +152,18 @@ cv::Mat ImageCapture::captureImage() {
             cv::resize(cropped, frame, cv::Size(cropped.cols, cropped.rows));  
             croppedWidth_ = cropped.cols;
             croppedHeight_ = cropped.rows;
+            frameMetadata_.rowOffset = tableRect.y;
         }
     }
     return frame;
 }
 
+// Dequeue a frame without decoding it, keeps the camera queue fresh at almost no CPU cost
+bool ImageCapture::grabFrame() {
+    if (!cap_.isOpened()) return false;
+    return cap_.grab();
+}
+
 cv::Mat ImageCapture::captureRawImage() {
     cv::Mat frame;
     if (cap_.isOpened()) {
@@ -184,19 +196,65 @@ bool ImageCapture::saveImage(const cv::Mat& image, const std::string& filename)
 }
 
 cv::Point2f ImageCapture::detectPuck(const cv::Mat& grayImage) {
+    return detectBlob(grayImage, config_.PUCK_THRESHOLD, config_.PUCK_MIN_AREA, config_.PUCK_MAX_AREA, cv::Rect(0, 0, grayImage.cols, grayImage.rows), cv::Point2f(-1, -1), 0.0f);
+}
+
+cv::Point2f ImageCapture::detectMallet(const cv::Mat& grayImage, cv::Point2f puckCenter, const cv::Rect& searchRegion) {
     if (grayImage.empty()) return cv::Point2f(-1, -1);
 
-    cv::Mat blurred;
-    cv::GaussianBlur(grayImage, blurred, cv::Size(5, 5), 0);
+    // Reject the blob that is the puck itself
+    float puckRadiusPx = config_.PUCK_RADIUS_REAL * grayImage.cols / config_.PHYSICAL_TABLE_WIDTH;
+    return detectBlob(grayImage, config_.MALLET_THRESHOLD, config_.MALLET_MIN_AREA, config_.MALLET_MAX_AREA, searchRegion, puckCenter, puckRadiusPx * 1.5f);
+}
 
-    std::vector<int> threshTypes = { cv::THRESH_BINARY, cv::THRESH_BINARY_INV };
+cv::Point2f ImageCapture::detectBlob(const cv::Mat& grayImage, int threshold, int minArea, int maxArea, const cv::Rect& searchRegion, cv::Point2f excludeCenter, float excludeRadius) {
+    std::vector<BlobCandidate> blobs;
+    collectBlobs(grayImage, threshold, minArea, maxArea, searchRegion, excludeCenter, excludeRadius, blobs);
 
     double bestScore = 0.0;
     cv::Point2f bestCenter(-1, -1);
+    for (const BlobCandidate& blob : blobs) {
+        if (blob.score > bestScore) {
+            bestScore = blob.score;
+            bestCenter = blob.center;
+        }
+    }
+    return bestCenter;
+}
+
+void ImageCapture::detectPuckCandidates(const cv::Mat& grayImage, std::vector<cv::Point2f>& candidates, size_t maxCandidates) {
+    candidates.clear();
+    std::vector<BlobCandidate> blobs;
+    collectBlobs(grayImage, config_.PUCK_THRESHOLD, config_.PUCK_MIN_AREA, config_.PUCK_MAX_AREA, cv::Rect(0, 0, grayImage.cols, grayImage.rows), cv::Point2f(-1, -1), 0.0f, blobs);
+    std::stable_sort(blobs.begin(), blobs.end(), [](const BlobCandidate& a, const BlobCandidate& b) { return a.score > b.score; });
+
+    // Both threshold polarities can outline the same object; keep the better-scoring outline
+    float puckRadiusPx = config_.PUCK_RADIUS_REAL * grayImage.cols / config_.PHYSICAL_TABLE_WIDTH;
+    for (const BlobCandidate& blob : blobs) {
+        if (candidates.size() >= maxCandidates) break;
+        bool duplicate = false;
+        for (const cv::Point2f& c : candidates) {
+            if (cv::norm(blob.center - c) < puckRadiusPx) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate) candidates.push_back(blob.center);
+    }
+}
+
+void ImageCapture::collectBlobs(const cv::Mat& grayImage, int threshold, int minArea, int maxArea, const cv::Rect& searchRegion, cv::Point2f excludeCenter, float excludeRadius, std::vector<BlobCandidate>& blobs) {
+    blobs.clear();
+    if (grayImage.empty()) return;
+
+    cv::Mat blurred;
+    cv::GaussianBlur(grayImage, blurred, cv::Size(5, 5), 0);
+
+    std::vector<int> threshTypes = { cv::THRESH_BINARY, cv::THRESH_BINARY_INV };
 
     for (int t : threshTypes) {
         cv::Mat thresh;
-        cv::threshold(blurred, thresh, config_.PUCK_THRESHOLD, 255, t);
+        cv::threshold(blurred, thresh, threshold, 255, t);
 
         cv::morphologyEx(thresh, thresh, cv::MORPH_OPEN, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3)));
 
@@ -205,35 +263,32 @@ cv::Point2f ImageCapture::detectPuck(const cv::Mat& grayImage) {
 
         for (const auto& contour : contours) {
             double area = cv::contourArea(contour);
-            if (area < config_.PUCK_MIN_AREA || area > config_.PUCK_MAX_AREA) continue;
+            if (area < minArea || area > maxArea) continue;
 
             double perimeter = cv::arcLength(contour, true);
             if (perimeter <= 1e-6) continue;
             double circularity = 4 * CV_PI * area / (perimeter * perimeter);
-
-                double score = circularity * area;
-                if (circularity >= 0.5 && score > bestScore) {
-                    cv::Point2f center;
-                    float radius;
-                    cv::minEnclosingCircle(contour, center, radius);
-
-                    // Ignore detections too close to table borders (3 cm margin)
-                    const double borderMm = 30.0; // 30 mm = 3 cm
-                    int imgW = grayImage.cols;
-                    int imgH = grayImage.rows;
-                    double marginX = (borderMm / config_.PHYSICAL_TABLE_WIDTH) * imgW;
-                    double marginY = (borderMm / config_.PHYSICAL_TABLE_HEIGHT) * imgH;
-                    if (center.x < marginX || center.x > (imgW - marginX) || center.y < marginY || center.y > (imgH - marginY)) {
-                        continue; // Skip noisy border detections
-                    }
-
-                    bestScore = score;
-                    bestCenter = center;
+            if (circularity < config_.PUCK_MIN_CIRCULARITY) continue;
+
+            cv::Point2f center;
+            float radius;
+            cv::minEnclosingCircle(contour, center, radius);
+
+            // Ignore detections too close to table borders (3 cm margin)
+            const double borderMm = 30.0; // 30 mm = 3 cm
+            int imgW = grayImage.cols;
+            int imgH = grayImage.rows;
+            double marginX = (borderMm / config_.PHYSICAL_TABLE_WIDTH) * imgW;
+            double marginY = (borderMm / config_.PHYSICAL_TABLE_HEIGHT) * imgH;
+            if (center.x < marginX || center.x > (imgW - marginX) || center.y < marginY || center.y > (imgH - marginY)) {
+                continue; // Skip noisy border detections
             }
+            if (!searchRegion.contains(cv::Point(center.x, center.y))) continue;
+            if (excludeCenter.x >= 0 && cv::norm(center - excludeCenter) < excludeRadius) continue;
+
+            blobs.push_back({center, circularity * area});
         }
     }
-
-    return bestCenter;
 }
 
 cv::Point2f ImageCapture::imageToTableCoordinates(cv::Point2f imagePoint, int imageWidth, int imageHeight) {
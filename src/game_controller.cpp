@@ -21,18 +21,21 @@ void GameController::renderDebugImage(const DebugRenderParams& params) {
         }
 
         // Draw predicted path 
-        uint64_t predictedEntryTimeUs = 0;
+        uint64_t predictedEntryTimeUs = params.predictedEntryTimeUs;
         const uint64_t maxLookaheadUs = 2000000; // 2 seconds
         const uint64_t stepUs = 50000; // 50 ms
+        const size_t pathSteps = maxLookaheadUs / stepUs + 1;
+        uint64_t pathTimes[pathSteps];
+        cv::Point2f pathTable[pathSteps];
+        for (size_t i = 0; i < pathSteps; ++i) pathTimes[i] = params.currentTimeUs + i * stepUs;
+        params.snapshot.predictPositions(pathTimes, pathTable, pathSteps);
+
         std::vector<cv::Point> pathPoints;
-        for (uint64_t t = params.currentTimeUs; t <= params.currentTimeUs + maxLookaheadUs; t += stepUs) {
-            cv::Point2f p = params.predictor.predictPosition(t);
+        for (size_t i = 0; i < pathSteps; ++i) {
+            const cv::Point2f& p = pathTable[i];
             if (p.x < 0 || p.y < 0) continue;
             cv::Point imgPt = params.capture.TableToImageCoordinates(p, params.capture.getCroppedWidth(), params.capture.getCroppedHeight());
             pathPoints.push_back(imgPt);
-            if (params.predictor.isInDefenseZone(p) && predictedEntryTimeUs == 0) {
-                predictedEntryTimeUs = t;
-            }
         }
         for (size_t i = 1; i < pathPoints.size(); ++i) {
             cv::line(debugImg, pathPoints[i-1], pathPoints[i], cv::Scalar(0, 255, 0), 1);
@@ -49,7 +52,7 @@ void GameController::renderDebugImage(const DebugRenderParams& params) {
         line1 << "Idx:" << std::setw(4) << std::setfill('0') << params.debugImageIndex << "  FPS:" << std::fixed << std::setprecision(1) << params.fps;
         line2 << "Conf:" << std::fixed << std::setprecision(2) << params.velocityConfidence << "  V(mm/s):" << std::fixed << std::setprecision(1) << speed;
         if (predictedEntryTimeUs > 0) {
-            double timeUntilMs = (predictedEntryTimeUs - params.currentTimeUs) / 1000.0;
+            double timeUntilMs = ((int64_t)predictedEntryTimeUs - (int64_t)params.currentTimeUs) / 1000.0;
             line2 << "  Tentry(ms):" << std::fixed << std::setprecision(0) << timeUntilMs;
         } else {
             line2 << "  Tentry(ms):unknown";
@@ -0,0 +1,87 @@
+#include "idle_monitor.hpp"
+#include <iostream>
+
+namespace {
+const int DOWNSAMPLE = 4;                // frame difference runs on a 1/4 x 1/4 image
+const double ACTIVITY_DISTANCE_MM = 10.0; // puck displacement that counts as motion
+}
+
+IdleMonitor::IdleMonitor(const Config& config) : config_(config), idle_(false), lastActivityUs_(0), anchorPos_(-1, -1), anchorValid_(false), frameCounter_(0), skippedFrames_(0), lastCheckUs_(0), wakePending_(false), wakeFrameUs_(0), wakeCheckGapUs_(0) {}
+
+void IdleMonitor::observePuck(const cv::Point2f& tablePos, bool detected, uint64_t timestampUs) {
+    if (lastActivityUs_ == 0) lastActivityUs_ = timestampUs;
+
+    if (detected) {
+        if (!anchorValid_ || cv::norm(tablePos - anchorPos_) > ACTIVITY_DISTANCE_MM) {
+            anchorPos_ = tablePos;
+            anchorValid_ = true;
+            lastActivityUs_ = timestampUs;
+        }
+    }
+
+    if (config_.IDLE_ENABLED && !idle_ && timestampUs > lastActivityUs_ &&
+        (timestampUs - lastActivityUs_) / 1000000.0 >= config_.IDLE_TIMEOUT_S) {
+        enterIdle();
+    }
+}
+
+void IdleMonitor::enterIdle() {
+    idle_ = true;
+    frameCounter_ = 0;
+    skippedFrames_ = 0;
+    lastCheckUs_ = 0;
+    reference_.release();
+    std::cout << "Idle: no puck motion for " << config_.IDLE_TIMEOUT_S << " s, checking every " << config_.IDLE_FRAME_DECIMATION << " frames" << std::endl;
+}
+
+bool IdleMonitor::shouldCheckFrame() {
+    if (++frameCounter_ >= config_.IDLE_FRAME_DECIMATION) {
+        frameCounter_ = 0;
+        return true;
+    }
+    skippedFrames_++;
+    return false;
+}
+
+bool IdleMonitor::detectMotion(const cv::Mat& frame, uint64_t timestampUs) {
+    if (frame.empty()) return false;
+    uint64_t previousCheckUs = lastCheckUs_;
+    lastCheckUs_ = timestampUs;
+
+    if (frame.channels() == 3) {
+        cv::Mat gray;
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        cv::resize(gray, small_, cv::Size(frame.cols / DOWNSAMPLE, frame.rows / DOWNSAMPLE), 0, 0, cv::INTER_AREA);
+    } else {
+        cv::resize(frame, small_, cv::Size(frame.cols / DOWNSAMPLE, frame.rows / DOWNSAMPLE), 0, 0, cv::INTER_AREA);
+    }
+
+    if (reference_.empty() || reference_.size() != small_.size()) {
+        small_.copyTo(reference_);
+        return false;
+    }
+
+    cv::absdiff(small_, reference_, diff_);
+    cv::threshold(diff_, diff_, config_.IDLE_DIFF_THRESHOLD, 255, cv::THRESH_BINARY);
+    int changed = cv::countNonZero(diff_);
+    small_.copyTo(reference_);
+    if (changed < config_.IDLE_MIN_CHANGED_PIXELS) return false;
+
+    // Motion: back to full rate starting with this very frame
+    idle_ = false;
+    wakePending_ = true;
+    wakeFrameUs_ = timestampUs;
+    wakeCheckGapUs_ = previousCheckUs > 0 ? timestampUs - previousCheckUs : 0;
+    lastActivityUs_ = timestampUs;
+    anchorValid_ = false;
+    return true;
+}
+
+void IdleMonitor::completeWake(uint64_t timestampUs) {
+    if (!wakePending_) return;
+    wakePending_ = false;
+    double processingMs = (timestampUs - wakeFrameUs_) / 1000.0;
+    double checkGapMs = wakeCheckGapUs_ / 1000.0;
+    std::cout << "Woke from idle: wake frame processed " << processingMs << " ms after capture, motion detected at most "
+              << checkGapMs << " ms late (" << skippedFrames_ << " frames skipped while idle)" << std::endl;
+}
@@ -1,71 +1,122 @@
 #include "kalman.hpp"
+#include <cmath>
 
-KalmanFilter::KalmanFilter() {
-    // State: [x, y, vx, vy]
-    state_ = Eigen::VectorXd(4);
-    state_ << 0, 0, 0, 0;  // Initial state
+template <int StateDim, int MeasDim, typename Scalar>
+KalmanFilterT<StateDim, MeasDim, Scalar>::KalmanFilterT() {
+    // Measurement matrix: positions are observed directly
+    H_ = MeasModel::Zero();
+    H_.template leftCols<MeasDim>().setIdentity();
 
-    // Covariance matrix
-    P_ = Eigen::MatrixXd::Identity(4, 4) * 100;
+    // Measurement and process noise until setNoise() is called
+    R_ = MeasMatrix::Identity() * Scalar(0.1);
+    configuredQ_.setZero();
+    configuredQ_.diagonal().template head<MeasDim>().setConstant(Scalar(0.01));
+    configuredQ_.diagonal().template tail<StateDim - MeasDim>().setConstant(Scalar(0.5));
 
-    // State transition matrix 
-    F_ = Eigen::MatrixXd::Identity(4, 4);
+    innovation_.setZero();
+    innovationCov_ = R_;
 
-    // Measurement matrix 
-    H_ = Eigen::MatrixXd(2, 4);
-    H_ << 1, 0, 0, 0,
-          0, 1, 0, 0;
-
-    // Process noise 
-    Q_ = Eigen::MatrixXd::Zero(4, 4);
-    Q_(0,0) = 0.01;
-    Q_(1,1) = 0.01;
-    Q_(2,2) = 0.5;
-    Q_(3,3) = 0.5;
+    reset();
+}
 
-    // Measurement noise
-    R_ = Eigen::MatrixXd::Identity(2, 2) * 0.1;
+template <int StateDim, int MeasDim, typename Scalar>
+void KalmanFilterT<StateDim, MeasDim, Scalar>::setNoise(double positionVariance, double velocityVariance, double measurementVariance) {
+    configuredQ_.setZero();
+    configuredQ_.diagonal().template head<MeasDim>().setConstant(Scalar(positionVariance));
+    configuredQ_.diagonal().template tail<StateDim - MeasDim>().setConstant(Scalar(velocityVariance));
+    Q_ = configuredQ_;
+    R_ = MeasMatrix::Identity() * Scalar(measurementVariance);
 }
 
-void KalmanFilter::reset() {
-    state_ = Eigen::VectorXd(4);
-    state_ << 0, 0, 0, 0;
-    P_ = Eigen::MatrixXd::Identity(4, 4) * 100;
+template <int StateDim, int MeasDim, typename Scalar>
+void KalmanFilterT<StateDim, MeasDim, Scalar>::reset() {
+    state_.setZero();
+    P_ = StateMatrix::Identity() * Scalar(100);
+
+    F_.setIdentity();
+    Q_ = configuredQ_;
+}
 
-    F_ = Eigen::MatrixXd::Identity(4, 4);
+// Transition for a time step, written into F in place. With a velocity decay k (1/s)
+// the velocity falls off as exp(-k*dt); k = 0 is plain constant velocity.
+template <int StateDim, int MeasDim, typename Scalar>
+void KalmanFilterT<StateDim, MeasDim, Scalar>::setTransition(double dt, double velocityDecay) {
+    double velocityGain = 1.0;
+    double positionGain = dt;
+    if (velocityDecay > 0.0) {
+        velocityGain = std::exp(-velocityDecay * dt);
+        positionGain = (1.0 - velocityGain) / velocityDecay;
+    }
+    F_.setIdentity();
+    for (int i = 0; i < MeasDim && i + MeasDim < StateDim; ++i) {
+        F_(i, i + MeasDim) = Scalar(positionGain);
+        F_(i + MeasDim, i + MeasDim) = Scalar(velocityGain);
+    }
+}
 
-    Q_ = Eigen::MatrixXd::Zero(4, 4);
-    Q_(0,0) = 0.01;
-    Q_(1,1) = 0.01;
-    Q_(2,2) = 0.5;
-    Q_(3,3) = 0.5;
+// Mirror the state across the wall coordinate on one measured axis; the normal velocity
+// keeps the restitution fraction of its speed. The Jacobian is -1 on that position and
+// -restitution on that velocity, so their covariance rows/columns are scaled accordingly.
+template <int StateDim, int MeasDim, typename Scalar>
+void KalmanFilterT<StateDim, MeasDim, Scalar>::reflect(int axis, double wall, double restitution) {
+    Scalar e = Scalar(restitution);
+    state_(axis) = Scalar(2.0 * wall) - state_(axis);
+    state_(axis + MeasDim) = -e * state_(axis + MeasDim);
+    P_.row(axis) *= Scalar(-1);
+    P_.col(axis) *= Scalar(-1);
+    P_.row(axis + MeasDim) *= -e;
+    P_.col(axis + MeasDim) *= -e;
 }
 
-void KalmanFilter::predict() {
+template <int StateDim, int MeasDim, typename Scalar>
+void KalmanFilterT<StateDim, MeasDim, Scalar>::predict() {
     state_ = F_ * state_;
     P_ = F_ * P_ * F_.transpose() + Q_;
 }
 
-void KalmanFilter::update(const Eigen::VectorXd& measurement) {
-    Eigen::VectorXd y = measurement - H_ * state_;
-    Eigen::MatrixXd S = H_ * P_ * H_.transpose() + R_;
-    Eigen::MatrixXd K = P_ * H_.transpose() * S.inverse();
-    state_ = state_ + K * y;
-    P_ = (Eigen::MatrixXd::Identity(4, 4) - K * H_) * P_;
+// Measurement update; noiseScale > 1 inflates R to down-weight a doubtful measurement.
+// The covariance uses the Joseph form, which stays positive semi-definite under rounding
+// (the short (I - KH) P form does not), and is re-symmetrized so errors cannot accumulate.
+template <int StateDim, int MeasDim, typename Scalar>
+void KalmanFilterT<StateDim, MeasDim, Scalar>::update(const MeasVector& measurement, double noiseScale) {
+    MeasMatrix R = R_ * Scalar(noiseScale);
+    innovation_ = measurement - H_ * state_;
+    innovationCov_ = H_ * P_ * H_.transpose() + R;
+    GainMatrix K = P_ * H_.transpose() * invert(innovationCov_);
+    state_ += K * innovation_;
+    StateMatrix A = StateMatrix::Identity() - K * H_;
+    P_ = A * P_ * A.transpose() + K * R * K.transpose();
+    P_ = Scalar(0.5) * (P_ + P_.transpose());
 }
 
-Eigen::VectorXd KalmanFilter::getState() const {
-    return state_;
+// Squared Mahalanobis distance of a measurement from the current (predicted) state
+template <int StateDim, int MeasDim, typename Scalar>
+double KalmanFilterT<StateDim, MeasDim, Scalar>::mahalanobis(const MeasVector& measurement) const {
+    MeasVector y = measurement - H_ * state_;
+    MeasMatrix S = H_ * P_ * H_.transpose() + R_;
+    return y.dot(invert(S) * y);
 }
 
-void KalmanFilter::setState(const Eigen::VectorXd& state) {
-    state_ = state;
+// Gaussian log-likelihood of the last innovation
+template <int StateDim, int MeasDim, typename Scalar>
+double KalmanFilterT<StateDim, MeasDim, Scalar>::getLogLikelihood() const {
+    double mahalanobis = innovation_.dot(invert(innovationCov_) * innovation_);
+    return -0.5 * (mahalanobis + std::log((double)innovationCov_.determinant()) + MeasDim * std::log(2.0 * M_PI));
 }
 
-void KalmanFilter::setF(const Eigen::MatrixXd& F) {
-    F_ = F;
+template <int StateDim, int MeasDim, typename Scalar>
+typename KalmanFilterT<StateDim, MeasDim, Scalar>::MeasMatrix KalmanFilterT<StateDim, MeasDim, Scalar>::invert(const MeasMatrix& S) {
+    if constexpr (MeasDim == 2) {
+        // Closed-form 2x2 inverse
+        Scalar det = S(0, 0) * S(1, 1) - S(0, 1) * S(1, 0);
+        MeasMatrix inv;
+        inv << S(1, 1), -S(0, 1),
+               -S(1, 0), S(0, 0);
+        return inv / det;
+    } else {
+        return S.inverse();
+    }
 }
 
-Eigen::MatrixXd KalmanFilter::getCovariance() const {
-    return P_;
-}
+template class KalmanFilterT<4, 2, double>;
+template class KalmanFilterT<4, 2, float>;
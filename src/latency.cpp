@@ -0,0 +1,62 @@
+#include "latency.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+
+namespace {
+const double MEAN_ALPHA = 0.05;  // EMA weight of the newest sample
+}
+
+LatencyTracker::LatencyTracker(const Config& config) : config_(config), frameTimestampUs_(0), lastMarkUs_(0) {
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        stageMeanUs_[i] = 0.0;
+        stageMaxUs_[i] = 0.0;
+        stageSeen_[i] = false;
+    }
+}
+
+uint64_t LatencyTracker::nowUs() {
+    return (uint64_t)(cv::getTickCount() / cv::getTickFrequency() * 1000000.0);
+}
+
+void LatencyTracker::beginFrame(uint64_t captureTimestampUs) {
+    frameTimestampUs_ = captureTimestampUs;
+    lastMarkUs_ = captureTimestampUs;
+}
+
+// Time since the previous mark (or the capture timestamp) is attributed to this stage
+void LatencyTracker::mark(LatencyStage stage) {
+    uint64_t now = nowUs();
+    double elapsed = now > lastMarkUs_ ? (double)(now - lastMarkUs_) : 0.0;
+    lastMarkUs_ = now;
+    record(stage, elapsed);
+}
+
+void LatencyTracker::record(LatencyStage stage, double elapsed) {
+    if (!stageSeen_[stage]) {
+        stageMeanUs_[stage] = elapsed;
+        stageSeen_[stage] = true;
+    } else {
+        stageMeanUs_[stage] += MEAN_ALPHA * (elapsed - stageMeanUs_[stage]);
+    }
+    stageMaxUs_[stage] = std::max(stageMaxUs_[stage], elapsed);
+}
+
+// When a command decided now takes effect: the rest of the pipeline up to sendto plus
+// the robot's transit and start-up delay
+uint64_t LatencyTracker::actionTimestamp() const {
+    return nowUs() + (uint64_t)(stageMeanUs_[STAGE_SEND] + config_.ACTUATION_DELAY_MS * 1000.0);
+}
+
+double LatencyTracker::getCaptureToActionUs() const {
+    double total = config_.ACTUATION_DELAY_MS * 1000.0;
+    for (int i = 0; i < STAGE_COUNT; ++i) total += stageMeanUs_[i];
+    return total;
+}
+
+void LatencyTracker::print(std::ostream& out) const {
+    out << "Latency (mean/max ms): detect " << stageMeanUs_[STAGE_DETECT] / 1000.0 << "/" << stageMaxUs_[STAGE_DETECT] / 1000.0
+        << ", predict " << stageMeanUs_[STAGE_PREDICT] / 1000.0 << "/" << stageMaxUs_[STAGE_PREDICT] / 1000.0
+        << ", send " << stageMeanUs_[STAGE_SEND] / 1000.0 << "/" << stageMaxUs_[STAGE_SEND] / 1000.0
+        << ", actuation " << config_.ACTUATION_DELAY_MS
+        << ", capture to action " << getCaptureToActionUs() / 1000.0 << std::endl;
+}
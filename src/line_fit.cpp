@@ -0,0 +1,284 @@
+#include "line_fit.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const double MIN_NOISE_STD = 0.3;        // mm, floor for the residual-based noise estimate
+const double MIN_PAIR_DT = 1e-4;         // s, hypotheses from closer samples are skipped
+const int MIN_FIT_SAMPLES = 3;           // a leg after a bounce keeps the carried velocity until then
+const double MAX_SPEED = 6000.0;         // mm/s, faster apparent motion between two samples is not a hit
+}
+
+LineFitEstimator::LineFitEstimator(const Config& config) : config_(&config) {
+    reset();
+}
+
+void LineFitEstimator::reset() {
+    end_ = 0;
+    stored_ = 0;
+    size_ = 0;
+    hasPending_ = false;
+    canRevert_ = false;
+    hasCarriedVelocity_ = false;
+    hasEstimate_ = false;
+    state_.setZero();
+    covariance_.setIdentity();
+    timestamp_ = 0;
+    inliers_ = 0;
+    segments_ = 0;
+    random_ = 12345;
+}
+
+int LineFitEstimator::window() const {
+    return std::max(2, std::min(config_->LINE_FIT_WINDOW, (int)MAX_WINDOW));
+}
+
+void LineFitEstimator::push(const Sample& s) {
+    ring_[end_] = s;
+    end_ = (end_ + 1) % MAX_WINDOW;
+    stored_ = std::min(stored_ + 1, (int)MAX_WINDOW);
+    size_ = std::min(size_ + 1, window());
+}
+
+// The ring keeps its samples, so a leg started by mistake can be undone
+void LineFitEstimator::startSegment() {
+    size_ = 0;
+    hasCarriedVelocity_ = false;
+    segments_++;
+}
+
+bool LineFitEstimator::addMeasurement(const cv::Point2f& position, uint64_t timestamp) {
+    if (hasEstimate_) {
+        double dt = ((int64_t)timestamp - (int64_t)timestamp_) / 1000000.0;
+        if (dt <= 0.0) return false;
+        if (dt > config_->TRACK_MAX_GAP_S) reset();
+    }
+    Sample s = {position, timestamp};
+    if (!hasEstimate_) {
+        startSegment();
+        push(s);
+        fit();
+        return true;
+    }
+
+    // A wall contact before this sample ends the leg; the reflected fit carries over
+    if (reflectAtWall(position, timestamp)) {
+        push(s);
+        fit();
+        return true;
+    }
+
+    double dt = ((int64_t)timestamp - (int64_t)timestamp_) / 1000000.0;
+    cv::Point2f predicted(state_(0) + state_(2) * dt, state_(1) + state_(3) * dt);
+    double offset = cv::norm(position - predicted);
+
+    // The sample after a hit decides between the new leg and the one before it: two
+    // outliers in a row look like a hit until the puck shows up on the old line again
+    if (canRevert_) {
+        canRevert_ = false;
+        double dtBefore = ((int64_t)timestamp - (int64_t)revertTimestamp_) / 1000000.0;
+        cv::Point2f before(revertState_(0) + revertState_(2) * dtBefore, revertState_(1) + revertState_(3) * dtBefore);
+        double offsetBefore = cv::norm(position - before);
+        if (offsetBefore < config_->LINE_FIT_BREAK_MM && offsetBefore < offset) {
+            size_ = std::min(std::min(revertSize_ + 2, stored_), window());
+            segments_--;
+            push(s);
+            fit();
+            return true;
+        }
+    }
+
+    if ((size_ >= 2 || hasCarriedVelocity_) && offset > config_->LINE_FIT_BREAK_MM) {
+        double gap = ((int64_t)timestamp - (int64_t)pending_.timestamp) / 1000000.0;
+        if (!hasPending_ || cv::norm(position - pending_.position) > MAX_SPEED * gap) {
+            pending_ = s;
+            hasPending_ = true;
+            return false;
+        }
+        // Two samples in a row off the line: the puck was hit, a new leg starts with them
+        revertState_ = state_;
+        revertTimestamp_ = timestamp_;
+        revertSize_ = size_;
+        canRevert_ = true;
+        startSegment();
+        push(pending_);
+        hasPending_ = false;
+        push(s);
+        fit();
+        return true;
+    }
+
+    hasPending_ = false;  // a single sample off the line is an outlier
+    push(s);
+    fit();
+    return true;
+}
+
+// Checks whether the current line reaches a wall before the timestamp. If so, and the
+// sample is closer to the reflected path than to the straight one (near the wall the line
+// may overshoot by a little), the leg restarts there with the reflected velocity.
+bool LineFitEstimator::reflectAtWall(const cv::Point2f& position, uint64_t timestamp) {
+    if (size_ < 2 && !hasCarriedVelocity_) return false;
+    double dt = ((int64_t)timestamp - (int64_t)timestamp_) / 1000000.0;
+    double x = state_(0), y = state_(1), vx = state_(2), vy = state_(3);
+
+    double tHit = dt;
+    int wall = -1;
+    auto check = [&](int w, double distance, double speed) {
+        if (speed <= 0.0) return;
+        double t = std::max(distance, 0.0) / speed;
+        if (t < tHit) {
+            tHit = t;
+            wall = w;
+        }
+    };
+    check(0, x - config_->wallCoordinate(0), -vx);
+    check(1, config_->wallCoordinate(1) - x, vx);
+    check(2, y - config_->wallCoordinate(2), -vy);
+    check(3, config_->wallCoordinate(3) - y, vy);
+    if (wall < 0) return false;
+
+    int axis = wall < 2 ? 0 : 1;
+    double straight = axis == 0 ? x + vx * dt : y + vy * dt;
+    double reflected = 2.0 * config_->wallCoordinate(wall) - straight;
+    double measured = axis == 0 ? position.x : position.y;
+    if (std::abs(measured - straight) < std::abs(measured - reflected)) return false;
+
+    double e = config_->wallRestitution(wall);
+    carriedVelocity_ = wall < 2 ? cv::Point2f(-e * vx, vy) : cv::Point2f(vx, -e * vy);
+    carriedVelocityVar_ = std::max(covariance_(2, 2), covariance_(3, 3));
+    startSegment();
+    hasCarriedVelocity_ = true;
+    hasPending_ = false;
+    canRevert_ = false;
+    return true;
+}
+
+// RANSAC over two-sample line hypotheses (every pair when there are few samples, random
+// pairs otherwise), then least squares on the inliers of the best one. The covariance
+// uses the residual spread of the inliers as the measurement noise.
+void LineFitEstimator::fit() {
+    const Sample& last = sample(size_ - 1);
+    auto timeOf = [&](int i) { return ((int64_t)sample(i).timestamp - (int64_t)last.timestamp) / 1000000.0; };
+
+    // Too few samples for a line: the velocity comes from the bounce (or is unknown) and
+    // the position is the mean of the samples moved along it to the last one
+    if (size_ == 1 || (hasCarriedVelocity_ && size_ < MIN_FIT_SAMPLES)) {
+        cv::Point2f v = hasCarriedVelocity_ ? carriedVelocity_ : cv::Point2f(0, 0);
+        cv::Point2f p(0, 0);
+        for (int k = 0; k < size_; ++k) p += sample(k).position - v * (float)timeOf(k);
+        p = p * (1.0f / size_);
+        double r = MIN_NOISE_STD * MIN_NOISE_STD;
+        state_ << p.x, p.y, v.x, v.y;
+        covariance_.setZero();
+        covariance_(0, 0) = covariance_(1, 1) = r / size_;
+        covariance_(2, 2) = covariance_(3, 3) = hasCarriedVelocity_ ? carriedVelocityVar_ : (double)config_->TRACK_INIT_VELOCITY_STD * config_->TRACK_INIT_VELOCITY_STD;
+        inliers_ = size_;
+        timestamp_ = last.timestamp;
+        hasEstimate_ = true;
+        return;
+    }
+
+    // Leg copied out of the ring once, time measured from the last sample
+    double t[MAX_WINDOW], px[MAX_WINDOW], py[MAX_WINDOW];
+    for (int k = 0; k < size_; ++k) {
+        t[k] = timeOf(k);
+        px[k] = sample(k).position.x;
+        py[k] = sample(k).position.y;
+    }
+
+    const double thresholdSq = (double)config_->LINE_FIT_INLIER_MM * config_->LINE_FIT_INLIER_MM;
+    bool inlier[MAX_WINDOW];
+    std::fill(inlier, inlier + size_, true);
+    if (size_ > 2) {
+        int best = 0, bestI = 0, bestJ = 0;
+        double bestError = 0.0;
+        auto hypothesis = [&](int i, int j) {
+            if (std::abs(t[j] - t[i]) < MIN_PAIR_DT) return;
+            double vx = (px[j] - px[i]) / (t[j] - t[i]);
+            double vy = (py[j] - py[i]) / (t[j] - t[i]);
+            double x0 = px[i] - vx * t[i], y0 = py[i] - vy * t[i];
+            int count = 0;
+            double error = 0.0;
+            for (int k = 0; k < size_; ++k) {
+                double ex = px[k] - (x0 + vx * t[k]), ey = py[k] - (y0 + vy * t[k]);
+                double d = ex * ex + ey * ey;
+                if (d < thresholdSq) {
+                    count++;
+                    error += d;
+                }
+            }
+            if (count > best || (count == best && error < bestError)) {
+                best = count;
+                bestError = error;
+                bestI = i;
+                bestJ = j;
+            }
+        };
+        int pairs = size_ * (size_ - 1) / 2;
+        if (pairs <= config_->LINE_FIT_ITERATIONS) {
+            for (int i = 0; i < size_; ++i) {
+                for (int j = i + 1; j < size_; ++j) hypothesis(i, j);
+            }
+        } else {
+            for (int it = 0; it < config_->LINE_FIT_ITERATIONS; ++it) {
+                random_ = random_ * 1664525u + 1013904223u;
+                int i = (random_ >> 8) % size_;
+                random_ = random_ * 1664525u + 1013904223u;
+                int j = (random_ >> 8) % (size_ - 1);
+                if (j >= i) j++;
+                hypothesis(i, j);
+            }
+        }
+        if (best >= 2) {
+            double vx = (px[bestJ] - px[bestI]) / (t[bestJ] - t[bestI]);
+            double vy = (py[bestJ] - py[bestI]) / (t[bestJ] - t[bestI]);
+            double x0 = px[bestI] - vx * t[bestI], y0 = py[bestI] - vy * t[bestI];
+            for (int k = 0; k < size_; ++k) {
+                double ex = px[k] - (x0 + vx * t[k]), ey = py[k] - (y0 + vy * t[k]);
+                inlier[k] = ex * ex + ey * ey < thresholdSq;
+            }
+        }
+    }
+
+    // Least squares on the inliers
+    int n = 0;
+    double s1 = 0.0, s2 = 0.0, sx = 0.0, sy = 0.0, stx = 0.0, sty = 0.0;
+    for (int k = 0; k < size_; ++k) {
+        if (!inlier[k]) continue;
+        n++;
+        s1 += t[k];
+        s2 += t[k] * t[k];
+        sx += px[k];
+        sy += py[k];
+        stx += t[k] * px[k];
+        sty += t[k] * py[k];
+    }
+    double det = n * s2 - s1 * s1;
+    if (n < 2 || det <= 0.0) return;  // keep the previous estimate at its own time
+    double vx = (n * stx - s1 * sx) / det;
+    double vy = (n * sty - s1 * sy) / det;
+    double x = (sx - vx * s1) / n;
+    double y = (sy - vy * s1) / n;
+
+    double r = MIN_NOISE_STD * MIN_NOISE_STD;
+    if (n > 2) {
+        double sq = 0.0;
+        for (int k = 0; k < size_; ++k) {
+            if (!inlier[k]) continue;
+            double ex = px[k] - (x + vx * t[k]);
+            double ey = py[k] - (y + vy * t[k]);
+            sq += ex * ex + ey * ey;
+        }
+        r = std::max(r, sq / (2.0 * (n - 2)));
+    }
+
+    state_ << x, y, vx, vy;
+    covariance_.setZero();
+    covariance_(0, 0) = covariance_(1, 1) = r * s2 / det;
+    covariance_(0, 2) = covariance_(2, 0) = covariance_(1, 3) = covariance_(3, 1) = -r * s1 / det;
+    covariance_(2, 2) = covariance_(3, 3) = r * n / det;
+    inliers_ = n;
+    timestamp_ = last.timestamp;
+    hasEstimate_ = true;
+}
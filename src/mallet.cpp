@@ -0,0 +1,100 @@
+#include "mallet.hpp"
+#include <cmath>
+
+namespace {
+const double ALPHA = 0.6;        // position correction gain
+const double BETA = 0.3;         // velocity correction gain
+const int MAX_MISSED_FRAMES = 10; // drop the track after this many frames without a detection
+}
+
+MalletTracker::MalletTracker(const Config& config) : config_(config), position_(-1, -1), velocity_(0, 0), lastTimestamp_(0), measurements_(0), missedFrames_(0), tracking_(false) {}
+
+void MalletTracker::addMeasurement(const cv::Point2f& position, uint64_t timestamp) {
+    missedFrames_ = 0;
+    if (!tracking_) {
+        position_ = position;
+        velocity_ = cv::Point2f(0, 0);
+        lastTimestamp_ = timestamp;
+        measurements_ = 1;
+        tracking_ = true;
+        return;
+    }
+
+    double dt = ((int64_t)timestamp - (int64_t)lastTimestamp_) / 1000000.0;
+    if (dt <= 0) return;
+    lastTimestamp_ = timestamp;
+
+    cv::Point2f predicted = position_ + velocity_ * dt;
+    cv::Point2f residual = position - predicted;
+    if (measurements_ == 1) {
+        // Second sample: take the finite difference as the first velocity estimate
+        velocity_ = (position - position_) * (1.0 / dt);
+        position_ = position;
+    } else {
+        position_ = predicted + residual * ALPHA;
+        velocity_ = velocity_ + residual * (BETA / dt);
+    }
+    measurements_++;
+}
+
+void MalletTracker::markMissing() {
+    if (!tracking_) return;
+    if (++missedFrames_ > MAX_MISSED_FRAMES) reset();
+}
+
+void MalletTracker::reset() {
+    tracking_ = false;
+    measurements_ = 0;
+    missedFrames_ = 0;
+    velocity_ = cv::Point2f(0, 0);
+}
+
+cv::Point2f MalletTracker::predictPosition(uint64_t futureTimestamp) const {
+    if (!tracking_) return cv::Point2f(-1, -1);
+    double dt = ((int64_t)futureTimestamp - (int64_t)lastTimestamp_) / 1000000.0;
+    return position_ + velocity_ * dt;
+}
+
+ContactPrediction MalletTracker::predictContact(const cv::Point2f& puckPos, const cv::Point2f& puckVel, uint64_t timestamp) const {
+    ContactPrediction contact;
+    if (!tracking_ || measurements_ < 2) return contact;
+
+    // Relative motion of the puck seen from the mallet, both moving at constant velocity
+    cv::Point2f malletPos = predictPosition(timestamp);
+    cv::Point2f d = puckPos - malletPos;
+    cv::Point2f w = puckVel - velocity_;
+    double contactDist = config_.PUCK_RADIUS_REAL + config_.MALLET_RADIUS_REAL;
+
+    // Solve |d + w t| = contactDist for the first t >= 0
+    double a = w.dot(w);
+    double b = 2.0 * d.dot(w);
+    double c = d.dot(d) - contactDist * contactDist;
+    double t;
+    if (c <= 0.0) {
+        t = 0.0;  // already touching
+    } else {
+        if (a < 1e-9 || b >= 0.0) return contact;  // not closing in
+        double disc = b * b - 4.0 * a * c;
+        if (disc < 0.0) return contact;  // passes by without touching
+        t = (-b - std::sqrt(disc)) / (2.0 * a);
+    }
+    if (t > config_.MALLET_CONTACT_HORIZON_MS / 1000.0) return contact;
+
+    cv::Point2f puckAt = puckPos + puckVel * t;
+    cv::Point2f malletAt = malletPos + velocity_ * t;
+    cv::Point2f normal = puckAt - malletAt;
+    double len = cv::norm(normal);
+    if (len < 1e-6) return contact;
+    normal = normal * (1.0 / len);
+
+    // The mallet is much heavier than the puck: reflect the relative normal velocity
+    double closing = (puckVel - velocity_).dot(normal);
+    if (closing >= 0.0) return contact;  // separating at contact
+    cv::Point2f outgoing = puckVel - normal * ((1.0 + config_.MALLET_RESTITUTION) * closing);
+
+    contact.valid = true;
+    contact.timeToContact = t;
+    contact.puckAtContact = puckAt;
+    contact.outgoingVelocity = outgoing;
+    return contact;
+}
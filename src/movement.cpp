@@ -12,6 +12,8 @@ MovementController::MovementController(const Config& config, cv::Point2f initial
 #endif
 
 ), connected(false) {
+    setOriginCorner(config_.robot_origin_corner);
+
 #ifdef _WIN32
     // Initialize Winsock
     WSADATA wsaData;
@@ -49,6 +51,7 @@ MovementController::~MovementController() {
 
 bool MovementController::moveTo(cv::Point2f tablePosition) {
     if (!connected) return false;
+    std::lock_guard<std::mutex> lock(commandMutex_);
 
     if (tablePosition.x < 0 || tablePosition.y < 0 || tablePosition.x > config_.PHYSICAL_TABLE_WIDTH || tablePosition.y > config_.PHYSICAL_TABLE_HEIGHT) {
         std::cerr << "Warning: Attempting to move to out-of-bounds position (" << tablePosition.x << ", " << tablePosition.y << ")" << std::endl;
@@ -78,6 +81,7 @@ bool MovementController::moveTo(cv::Point2f tablePosition) {
 
 void MovementController::stop() {
     if (!connected) return;
+    std::lock_guard<std::mutex> lock(commandMutex_);
     int stopCode = 1;
     sendRawData(&stopCode, sizeof(stopCode));
 }
@@ -214,31 +218,16 @@ bool MovementController::sendRawData(const void* data, size_t size) {
 }
 
 cv::Point2f MovementController::TableToRobotCoordinates(cv::Point2f tablePosition) {
-    // Convert table coordinates to robot coordinates based on origin corner
+    return robotFromTable_.map(tablePosition);
+}
+
+void MovementController::setOriginCorner(int corner) {
     // Robot coordinates: X increases in the direction shown by red arrow, Y increases in direction shown by green arrow
-    float robotX, robotY;
-    switch (config_.robot_origin_corner) {
-    
-    case 0:  // top-left
-        robotX = tablePosition.y;
-        robotY = tablePosition.x;
-        break;
-    case 1: // top-right
-        robotY = config_.PHYSICAL_TABLE_WIDTH - tablePosition.x;
-        robotX = tablePosition.y;
-        break;
-    case 2: // bottom-left
-        robotX = tablePosition.x;
-        robotY = config_.PHYSICAL_TABLE_HEIGHT - tablePosition.y;
-        break;
-    case 3: // bottom-right
-        robotX = config_.PHYSICAL_TABLE_HEIGHT - tablePosition.y;
-        robotY = config_.PHYSICAL_TABLE_WIDTH - tablePosition.x;
-        break;
-    default:
-        robotX = tablePosition.y;
-        robotY = tablePosition.x;
-        break;
-    }
-    return cv::Point2f(robotX, robotY);
+    const float width = config_.PHYSICAL_TABLE_WIDTH, height = config_.PHYSICAL_TABLE_HEIGHT;
+    const AxisMap frames[4] = {
+        AxisMap(1, 1.0f, 0.0f, 0, 1.0f, 0.0f),           // top-left: X = y, Y = x
+        AxisMap(1, 1.0f, 0.0f, 0, -1.0f, width),         // top-right: X = y, Y = width - x
+        AxisMap(0, 1.0f, 0.0f, 1, -1.0f, height),        // bottom-left: X = x, Y = height - y
+        AxisMap(1, -1.0f, height, 0, -1.0f, width)};     // bottom-right: X = height - y, Y = width - x
+    robotFromTable_ = (corner >= 0 && corner < 4) ? frames[corner] : frames[0];
 }
@@ -0,0 +1,384 @@
+#include "multi_tracker.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const double NOT_ALLOWED = 1e9;           // cost of a pairing outside the gate
+const double REACQUIRE_RADIUS_MM = 60.0;  // how far a hit can move an object off its track in a frame or two
+const int MAX_ASSIGNMENT = MultiTargetTracker::MAX_TRACKS + MultiTargetTracker::MAX_DETECTIONS;
+
+// Minimum-cost assignment on a square n x n matrix (Hungarian algorithm with potentials,
+// O(n^3)). rowToCol[i] receives the column assigned to row i.
+void solveAssignment(const std::vector<double>& cost, int n, std::vector<int>& rowToCol) {
+    double u[MAX_ASSIGNMENT + 1], v[MAX_ASSIGNMENT + 1], minv[MAX_ASSIGNMENT + 1];
+    int p[MAX_ASSIGNMENT + 1], way[MAX_ASSIGNMENT + 1];
+    bool used[MAX_ASSIGNMENT + 1];
+    std::fill(u, u + n + 1, 0.0);
+    std::fill(v, v + n + 1, 0.0);
+    std::fill(p, p + n + 1, 0);
+    std::fill(way, way + n + 1, 0);
+
+    // 1-based indices; column 0 and p[] == 0 mark "unassigned"
+    for (int i = 1; i <= n; ++i) {
+        p[0] = i;
+        int j0 = 0;
+        std::fill(minv, minv + n + 1, 1e300);
+        std::fill(used, used + n + 1, false);
+        do {
+            used[j0] = true;
+            int i0 = p[j0], j1 = 0;
+            double delta = 1e300;
+            for (int j = 1; j <= n; ++j) {
+                if (used[j]) continue;
+                double cur = cost[(i0 - 1) * n + (j - 1)] - u[i0] - v[j];
+                if (cur < minv[j]) {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta) {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (int j = 0; j <= n; ++j) {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+        do {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    rowToCol.assign(n, -1);
+    for (int j = 1; j <= n; ++j) {
+        if (p[j] > 0) rowToCol[p[j] - 1] = j - 1;
+    }
+}
+}
+
+MultiTargetTracker::MultiTargetTracker(const Config& config) : config_(config) {
+    cost_.reserve(MAX_ASSIGNMENT * MAX_ASSIGNMENT);
+    assignment_.reserve(MAX_ASSIGNMENT);
+    assignedIds_.reserve(MAX_DETECTIONS);
+    reset();
+}
+
+void MultiTargetTracker::reset() {
+    count_ = 0;
+    nextId_ = 0;
+    lastTimestamp_ = 0;
+    assignedIds_.clear();
+}
+
+void MultiTargetTracker::update(const std::vector<cv::Point2f>& detections, uint64_t timestamp) {
+    int detectionCount = std::min((int)detections.size(), MAX_DETECTIONS);
+    double dt = lastTimestamp_ > 0 ? ((int64_t)timestamp - (int64_t)lastTimestamp_) / 1000000.0 : 0.0;
+    if (dt < 0.0) dt = 0.0;  // late frame: associate against the current estimates
+    else lastTimestamp_ = timestamp;
+
+    predict((Scalar)dt);
+    associate(detections, detectionCount);
+    correct();
+    reacquire(detections, detectionCount);
+
+    for (int i = 0; i < count_; ++i) {
+        if (weight_[i] > 0) {
+            hits_[i]++;
+            misses_[i] = 0;
+        } else {
+            misses_[i]++;
+        }
+    }
+    // Tentative tracks die on their first miss, confirmed ones after TRACKER_MAX_MISSES
+    for (int i = count_ - 1; i >= 0; --i) {
+        bool confirmed = hits_[i] >= config_.TRACKER_CONFIRM_HITS;
+        if (misses_[i] > (confirmed ? config_.TRACKER_MAX_MISSES : 0)) removeTrack(i);
+    }
+    for (int j = 0; j < detectionCount; ++j) {
+        if (assignedIds_[j] >= 0 || count_ >= MAX_TRACKS) continue;
+        assignedIds_[j] = nextId_;
+        addTrack(detections[j]);
+    }
+}
+
+// Constant-velocity prediction with white-noise acceleration, then reflection off the
+// walls the puck center can reach. Mallet centers stay farther from the walls than that.
+void MultiTargetTracker::predict(Scalar dt) {
+    const Scalar q = Scalar(config_.TRACKER_ACCEL_STD) * Scalar(config_.TRACKER_ACCEL_STD);
+    const Scalar dt2 = dt * dt;
+    const Scalar qpp = dt2 * dt2 / 4 * q, qpv = dt2 * dt / 2 * q, qvv = dt2 * q;
+    const Scalar r = Scalar(config_.TRACKER_MEASUREMENT_STD) * Scalar(config_.TRACKER_MEASUREMENT_STD);
+    const Scalar loX = Scalar(config_.PUCK_RADIUS_REAL), hiX = Scalar(config_.PHYSICAL_TABLE_WIDTH - config_.PUCK_RADIUS_REAL);
+    const Scalar loY = Scalar(config_.PUCK_RADIUS_REAL), hiY = Scalar(config_.PHYSICAL_TABLE_HEIGHT - config_.PUCK_RADIUS_REAL);
+    const Scalar eX0 = Scalar(config_.WALL_RESTITUTION_X_MIN), eX1 = Scalar(config_.WALL_RESTITUTION_X_MAX);
+    const Scalar eY0 = Scalar(config_.WALL_RESTITUTION_Y_MIN), eY1 = Scalar(config_.WALL_RESTITUTION_Y_MAX);
+
+    for (int i = 0; i < count_; ++i) {
+        // P = F P F^T + Q, written out for F = [I dt*I; 0 I]
+        Scalar pxx = pxx_[i], pxy = pxy_[i], pxvx = pxvx_[i], pxvy = pxvy_[i], pyy = pyy_[i];
+        Scalar pyvx = pyvx_[i], pyvy = pyvy_[i], pvxvx = pvxvx_[i], pvxvy = pvxvy_[i], pvyvy = pvyvy_[i];
+        pxx = pxx + 2 * dt * pxvx + dt2 * pvxvx + qpp;
+        pxy = pxy + dt * (pxvy + pyvx) + dt2 * pvxvy;
+        pyy = pyy + 2 * dt * pyvy + dt2 * pvyvy + qpp;
+        pxvx = pxvx + dt * pvxvx + qpv;
+        pxvy = pxvy + dt * pvxvy;
+        pyvx = pyvx + dt * pvxvy;
+        pyvy = pyvy + dt * pvyvy + qpv;
+        pvxvx += qvv;
+        pvyvy += qvv;
+
+        Scalar x = x_[i] + dt * vx_[i];
+        Scalar y = y_[i] + dt * vy_[i];
+
+        // Reflection: position mirrored, velocity reversed and scaled by the restitution.
+        // Covariance entries pick up the product of the two rows' factors.
+        bool lowX = x < loX, highX = x > hiX, lowY = y < loY, highY = y > hiY;
+        Scalar fx = (lowX || highX) ? Scalar(-1) : Scalar(1);
+        Scalar fy = (lowY || highY) ? Scalar(-1) : Scalar(1);
+        Scalar fvx = lowX ? -eX0 : (highX ? -eX1 : Scalar(1));
+        Scalar fvy = lowY ? -eY0 : (highY ? -eY1 : Scalar(1));
+        x_[i] = lowX ? 2 * loX - x : (highX ? 2 * hiX - x : x);
+        y_[i] = lowY ? 2 * loY - y : (highY ? 2 * hiY - y : y);
+        vx_[i] *= fvx;
+        vy_[i] *= fvy;
+
+        pxx_[i] = pxx;
+        pxy_[i] = pxy * fx * fy;
+        pxvx_[i] = pxvx * fx * fvx;
+        pxvy_[i] = pxvy * fx * fvy;
+        pyy_[i] = pyy;
+        pyvx_[i] = pyvx * fy * fvx;
+        pyvy_[i] = pyvy * fy * fvy;
+        pvxvx_[i] = pvxvx * fvx * fvx;
+        pvxvy_[i] = pvxvy * fvx * fvy;
+        pvyvy_[i] = pvyvy * fvy * fvy;
+
+        // S = H P H^T + R, inverted in closed form
+        Scalar a = pxx + r, b = pxy * fx * fy, c = pyy + r;
+        Scalar invDet = 1 / (a * c - b * b);
+        sxx_[i] = c * invDet;
+        sxy_[i] = -b * invDet;
+        syy_[i] = a * invDet;
+    }
+}
+
+// Gated squared Mahalanobis distances, then an assignment over tracks and detections.
+// A track and a detection that only gate with each other are paired directly; the
+// Hungarian algorithm only sees the rest, so the usual well-separated objects cost
+// nothing beyond the distance pass. Its matrix is padded so every track may stay
+// unassigned and every detection may start a new track, each at half the gate: a pair
+// is only formed if it costs less than the gate.
+void MultiTargetTracker::associate(const std::vector<cv::Point2f>& detections, int detectionCount) {
+    assignedIds_.assign(detectionCount, -1);
+    for (int i = 0; i < count_; ++i) {
+        weight_[i] = 0;
+        mx_[i] = x_[i];
+        my_[i] = y_[i];
+    }
+    if (count_ == 0 || detectionCount == 0) return;
+
+    const Scalar gate = Scalar(config_.TRACKER_GATE_CHI2);
+    alignas(32) Scalar d2[MAX_DETECTIONS][MAX_TRACKS];
+    int trackCandidates[MAX_TRACKS] = {0};
+    int detectionCandidates[MAX_DETECTIONS] = {0};
+    for (int j = 0; j < detectionCount; ++j) {
+        const Scalar zx = detections[j].x, zy = detections[j].y;
+        for (int i = 0; i < count_; ++i) {
+            Scalar ex = zx - x_[i], ey = zy - y_[i];
+            d2[j][i] = ex * ex * sxx_[i] + 2 * ex * ey * sxy_[i] + ey * ey * syy_[i];
+        }
+        for (int i = 0; i < count_; ++i) {
+            if (d2[j][i] > gate) continue;
+            trackCandidates[i]++;
+            detectionCandidates[j]++;
+        }
+    }
+
+    auto assign = [&](int i, int j) {
+        weight_[i] = 1;
+        mx_[i] = detections[j].x;
+        my_[i] = detections[j].y;
+        assignedIds_[j] = id_[i];
+    };
+    int rows[MAX_TRACKS], cols[MAX_DETECTIONS];
+    int rowCount = 0, colCount = 0;
+    for (int j = 0; j < detectionCount; ++j) {
+        if (detectionCandidates[j] == 0) continue;
+        bool paired = false;
+        if (detectionCandidates[j] == 1) {
+            for (int i = 0; i < count_; ++i) {
+                if (d2[j][i] <= gate && trackCandidates[i] == 1) {
+                    assign(i, j);
+                    paired = true;
+                }
+            }
+        }
+        if (!paired) cols[colCount++] = j;
+    }
+    for (int i = 0; i < count_; ++i) {
+        if (trackCandidates[i] > 0 && weight_[i] == 0) rows[rowCount++] = i;
+    }
+    if (rowCount == 0 || colCount == 0) return;
+
+    const int n = rowCount + colCount;
+    cost_.assign(n * n, NOT_ALLOWED);
+    for (int r = 0; r < rowCount; ++r) {
+        for (int c = 0; c < colCount; ++c) {
+            Scalar d = d2[cols[c]][rows[r]];
+            if (d <= gate) cost_[r * n + c] = d;
+            cost_[(rowCount + c) * n + colCount + r] = 0.0;
+        }
+        cost_[r * n + colCount + r] = gate / 2;  // track unassigned
+    }
+    for (int c = 0; c < colCount; ++c) cost_[(rowCount + c) * n + c] = gate / 2;  // detection unassigned
+
+    solveAssignment(cost_, n, assignment_);
+    for (int r = 0; r < rowCount; ++r) {
+        int c = assignment_[r];
+        if (c < 0 || c >= colCount || cost_[r * n + c] >= NOT_ALLOWED) continue;
+        assign(rows[r], cols[c]);
+    }
+}
+
+// A confirmed track that lost its gate (the object was hit) picks up the nearest
+// unassigned detection within reach and restarts from it with an unknown velocity,
+// keeping its id.
+void MultiTargetTracker::reacquire(const std::vector<cv::Point2f>& detections, int detectionCount) {
+    for (int j = 0; j < detectionCount; ++j) {
+        if (assignedIds_[j] >= 0) continue;
+        int best = -1;
+        double bestDistance = REACQUIRE_RADIUS_MM;
+        for (int i = 0; i < count_; ++i) {
+            if (weight_[i] > 0 || hits_[i] < config_.TRACKER_CONFIRM_HITS) continue;
+            double distance = std::hypot(detections[j].x - x_[i], detections[j].y - y_[i]);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        if (best < 0) continue;
+        initTrack(best, detections[j]);
+        weight_[best] = 1;
+        assignedIds_[j] = id_[best];
+    }
+}
+
+// Kalman update of every track at once; unassigned tracks have weight 0 and a zero gain.
+// Only the upper triangle is stored, so the covariance stays symmetric by construction.
+void MultiTargetTracker::correct() {
+    for (int i = 0; i < count_; ++i) {
+        Scalar pxx = pxx_[i], pxy = pxy_[i], pxvx = pxvx_[i], pxvy = pxvy_[i], pyy = pyy_[i];
+        Scalar pyvx = pyvx_[i], pyvy = pyvy_[i];
+        Scalar w = weight_[i], sxx = sxx_[i], sxy = sxy_[i], syy = syy_[i];
+
+        // K = P H^T S^-1: column x of P times the first row of S^-1, column y the second
+        Scalar kx0 = w * (pxx * sxx + pxy * sxy), kx1 = w * (pxx * sxy + pxy * syy);
+        Scalar ky0 = w * (pxy * sxx + pyy * sxy), ky1 = w * (pxy * sxy + pyy * syy);
+        Scalar kvx0 = w * (pxvx * sxx + pyvx * sxy), kvx1 = w * (pxvx * sxy + pyvx * syy);
+        Scalar kvy0 = w * (pxvy * sxx + pyvy * sxy), kvy1 = w * (pxvy * sxy + pyvy * syy);
+
+        Scalar ex = mx_[i] - x_[i], ey = my_[i] - y_[i];
+        x_[i] += kx0 * ex + kx1 * ey;
+        y_[i] += ky0 * ex + ky1 * ey;
+        vx_[i] += kvx0 * ex + kvx1 * ey;
+        vy_[i] += kvy0 * ex + kvy1 * ey;
+
+        // P = P - K H P; row x of H P is (pxx, pxy, pxvx, pxvy), row y is (pxy, pyy, pyvx, pyvy)
+        pxx_[i] = pxx - kx0 * pxx - kx1 * pxy;
+        pxy_[i] = pxy - kx0 * pxy - kx1 * pyy;
+        pxvx_[i] = pxvx - kx0 * pxvx - kx1 * pyvx;
+        pxvy_[i] = pxvy - kx0 * pxvy - kx1 * pyvy;
+        pyy_[i] = pyy - ky0 * pxy - ky1 * pyy;
+        pyvx_[i] = pyvx - ky0 * pxvx - ky1 * pyvx;
+        pyvy_[i] = pyvy - ky0 * pxvy - ky1 * pyvy;
+        pvxvx_[i] -= kvx0 * pxvx + kvx1 * pyvx;
+        pvxvy_[i] -= kvx0 * pxvy + kvx1 * pyvy;
+        pvyvy_[i] -= kvy0 * pxvy + kvy1 * pyvy;
+    }
+}
+
+// Keeps the arrays dense: the last track moves into the freed slot
+void MultiTargetTracker::removeTrack(int index) {
+    int last = --count_;
+    if (index == last) return;
+    x_[index] = x_[last];
+    y_[index] = y_[last];
+    vx_[index] = vx_[last];
+    vy_[index] = vy_[last];
+    pxx_[index] = pxx_[last];
+    pxy_[index] = pxy_[last];
+    pxvx_[index] = pxvx_[last];
+    pxvy_[index] = pxvy_[last];
+    pyy_[index] = pyy_[last];
+    pyvx_[index] = pyvx_[last];
+    pyvy_[index] = pyvy_[last];
+    pvxvx_[index] = pvxvx_[last];
+    pvxvy_[index] = pvxvy_[last];
+    pvyvy_[index] = pvyvy_[last];
+    sxx_[index] = sxx_[last];
+    sxy_[index] = sxy_[last];
+    syy_[index] = syy_[last];
+    mx_[index] = mx_[last];
+    my_[index] = my_[last];
+    weight_[index] = weight_[last];
+    id_[index] = id_[last];
+    hits_[index] = hits_[last];
+    misses_[index] = misses_[last];
+}
+
+void MultiTargetTracker::addTrack(const cv::Point2f& position) {
+    int i = count_++;
+    initTrack(i, position);
+    id_[i] = nextId_++;
+    hits_[i] = 1;
+    misses_[i] = 0;
+}
+
+void MultiTargetTracker::initTrack(int i, const cv::Point2f& position) {
+    const Scalar r = Scalar(config_.TRACKER_MEASUREMENT_STD) * Scalar(config_.TRACKER_MEASUREMENT_STD);
+    x_[i] = position.x;
+    y_[i] = position.y;
+    vx_[i] = vy_[i] = 0;
+    pxx_[i] = pyy_[i] = r;
+    pvxvx_[i] = pvyvy_[i] = Scalar(config_.TRACK_INIT_VELOCITY_STD) * Scalar(config_.TRACK_INIT_VELOCITY_STD);
+    pxy_[i] = pxvx_[i] = pxvy_[i] = pyvx_[i] = pyvy_[i] = pvxvy_[i] = 0;
+    sxx_[i] = syy_[i] = 1 / (2 * r);
+    sxy_[i] = 0;
+    mx_[i] = x_[i];
+    my_[i] = y_[i];
+    weight_[i] = 0;
+}
+
+TrackState MultiTargetTracker::getTrack(int index) const {
+    TrackState t;
+    if (index < 0 || index >= count_) return t;
+    t.id = id_[index];
+    t.position = cv::Point2f(x_[index], y_[index]);
+    t.velocity = cv::Point2f(vx_[index], vy_[index]);
+    t.positionStd = cv::Point2f(std::sqrt(pxx_[index]), std::sqrt(pyy_[index]));
+    t.hits = hits_[index];
+    t.misses = misses_[index];
+    t.confirmed = hits_[index] >= config_.TRACKER_CONFIRM_HITS;
+    return t;
+}
+
+int MultiTargetTracker::findTrack(int id) const {
+    for (int i = 0; i < count_; ++i) {
+        if (id_[i] == id) return i;
+    }
+    return -1;
+}
+
+cv::Point2f MultiTargetTracker::predictPosition(int index, uint64_t futureTimestamp) const {
+    if (index < 0 || index >= count_) return cv::Point2f(-1, -1);
+    double dt = ((int64_t)futureTimestamp - (int64_t)lastTimestamp_) / 1000000.0;
+    return cv::Point2f(x_[index] + vx_[index] * dt, y_[index] + vy_[index] * dt);
+}
@@ -0,0 +1,243 @@
+#include "physics_estimator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace {
+const double LEG_BREAK_MM = 10.0;             // two samples this far off the fit end the leg
+const int QUADRATIC_MIN_SAMPLES = 20;         // fewer samples only support a straight-line fit
+const int BOUNCE_FIT_SAMPLES = 8;             // samples needed on each side of a bounce
+const double MIN_NORMAL_SPEED = 200.0;        // mm/s into the wall
+const double CONTACT_TOLERANCE_MM = 10.0;     // outgoing leg must start at the wall
+const double TANGENTIAL_TOLERANCE = 0.3;      // change of the wall-parallel velocity, fraction of the speed
+const double MIN_RESTITUTION = 0.2, MAX_RESTITUTION = 1.05;
+const double GLIDE_MIN_DURATION_S = 0.2;
+const double GLIDE_MIN_SPEED = 300.0;         // mm/s
+const double MAX_DECAY = 5.0;                 // 1/s
+}
+
+void LegFit::add(const PuckPosition& sample) {
+    if (count == 0) t0 = sample.timestamp;
+    double t = ((int64_t)sample.timestamp - (int64_t)t0) / 1000000.0;
+    double tk = 1.0;
+    for (int k = 0; k < 5; ++k) {
+        sumT[k] += tk;
+        if (k < 3) {
+            sumX[k] += sample.position.x * tk;
+            sumY[k] += sample.position.y * tk;
+        }
+        tk *= t;
+    }
+    count++;
+    duration = t;
+}
+
+bool LegFit::linear(double t, cv::Point2f& position, cv::Point2f& velocity) const {
+    double det = sumT[0] * sumT[2] - sumT[1] * sumT[1];
+    if (count < 2 || det <= 0.0) return false;
+    double vx = (sumT[0] * sumX[1] - sumT[1] * sumX[0]) / det;
+    double vy = (sumT[0] * sumY[1] - sumT[1] * sumY[0]) / det;
+    double x0 = (sumX[0] - vx * sumT[1]) / sumT[0];
+    double y0 = (sumY[0] - vy * sumT[1]) / sumT[0];
+    position = cv::Point2f(x0 + vx * t, y0 + vy * t);
+    velocity = cv::Point2f(vx, vy);
+    return true;
+}
+
+bool LegFit::quadratic(double t, cv::Point2f& position, cv::Point2f& velocity, cv::Point2f& acceleration) const {
+    if (count < 3) return false;
+    Eigen::Matrix3d A;
+    A << sumT[0], sumT[1], sumT[2],
+         sumT[1], sumT[2], sumT[3],
+         sumT[2], sumT[3], sumT[4];
+    Eigen::LDLT<Eigen::Matrix3d> ldlt(A);
+    if (ldlt.info() != Eigen::Success) return false;
+    Eigen::Vector3d cx = ldlt.solve(Eigen::Vector3d(sumX[0], sumX[1], sumX[2]));
+    Eigen::Vector3d cy = ldlt.solve(Eigen::Vector3d(sumY[0], sumY[1], sumY[2]));
+    position = cv::Point2f(cx(0) + cx(1) * t + cx(2) * t * t, cy(0) + cy(1) * t + cy(2) * t * t);
+    velocity = cv::Point2f(cx(1) + 2.0 * cx(2) * t, cy(1) + 2.0 * cy(2) * t);
+    acceleration = cv::Point2f(2.0 * cx(2), 2.0 * cy(2));
+    return true;
+}
+
+PhysicsEstimator::PhysicsEstimator(const Config& config) : config_(config), decaySum_(0.0), decayWeight_(0.0), glideCount_(0) {
+    for (int wall = 0; wall < 4; ++wall) {
+        restitutionSum_[wall] = 0.0;
+        bounceCount_[wall] = 0;
+    }
+    reset();
+}
+
+void PhysicsEstimator::reset() {
+    leg_ = LegFit();
+    hasPending_ = false;
+    incomingWall_ = -1;
+}
+
+bool PhysicsEstimator::addMeasurement(const PuckPosition& measurement) {
+    if (leg_.count > 0) {
+        double dt = ((int64_t)measurement.timestamp - (int64_t)last_.timestamp) / 1000000.0;
+        if (dt <= 0) return false;
+        if (dt > config_.TRACK_MAX_GAP_S) reset();
+    }
+    last_ = measurement;
+    if (leg_.count == 0) {
+        leg_.add(measurement);
+        return false;
+    }
+
+    bool sampled = false;
+    double t = ((int64_t)measurement.timestamp - (int64_t)leg_.t0) / 1000000.0;
+    cv::Point2f position, velocity, acceleration;
+    auto fit = [&](double at) {
+        return leg_.count >= QUADRATIC_MIN_SAMPLES ? leg_.quadratic(at, position, velocity, acceleration)
+                                                   : leg_.linear(at, position, velocity);
+    };
+    if (leg_.count >= 3 && fit(leg_.duration)) {
+        // Wall contact predicted between the last sample and this one: the leg ends there
+        double hitTime = std::numeric_limits<double>::infinity();
+        int wall = -1;
+        auto checkWall = [&](int w, double distance, double speed) {
+            if (speed <= 0.0) return;
+            double th = leg_.duration + std::max(distance, 0.0) / speed;
+            if (th < t && th < hitTime) {
+                hitTime = th;
+                wall = w;
+            }
+        };
+        checkWall(0, position.x - config_.wallCoordinate(0), -velocity.x);
+        checkWall(1, config_.wallCoordinate(1) - position.x, velocity.x);
+        checkWall(2, position.y - config_.wallCoordinate(2), -velocity.y);
+        checkWall(3, config_.wallCoordinate(3) - position.y, velocity.y);
+        if (wall >= 0) {
+            sampled = closeLeg(wall, hitTime);
+            leg_ = LegFit();
+            leg_.add(measurement);
+            hasPending_ = false;
+            return sampled;
+        }
+
+        if (fit(t) && cv::norm(measurement.position - position) > LEG_BREAK_MM) {
+            if (!hasPending_) {
+                pending_ = measurement;
+                hasPending_ = true;
+                return false;
+            }
+            // Two samples in a row off the fit: the puck was hit, a new leg starts with them
+            sampled = closeLeg(-1, 0.0);
+            leg_ = LegFit();
+            leg_.add(pending_);
+            leg_.add(measurement);
+            hasPending_ = false;
+            return sampled;
+        }
+    }
+
+    hasPending_ = false;  // a single sample off the fit is an outlier
+    leg_.add(measurement);
+    if (incomingWall_ >= 0 && leg_.count >= BOUNCE_FIT_SAMPLES) sampled = sampleBounce();
+    return sampled;
+}
+
+// Ends the current leg. Long legs give a glide decay sample; a leg ending at a wall is kept
+// until the outgoing leg has enough samples to compare against.
+bool PhysicsEstimator::closeLeg(int wall, double hitTime) {
+    bool sampled = false;
+    cv::Point2f position, velocity, acceleration;
+    if (leg_.count >= QUADRATIC_MIN_SAMPLES && leg_.duration >= GLIDE_MIN_DURATION_S &&
+        leg_.quadratic(leg_.duration / 2.0, position, velocity, acceleration)) {
+        double speedSq = velocity.dot(velocity);
+        if (speedSq >= GLIDE_MIN_SPEED * GLIDE_MIN_SPEED) {
+            // Exponential decay: the deceleration along the path is k * speed
+            double decay = -acceleration.dot(velocity) / speedSq;
+            if (std::abs(decay) < MAX_DECAY) {
+                decaySum_ += decay * leg_.duration;
+                decayWeight_ += leg_.duration;
+                glideCount_++;
+                sampled = true;
+            }
+        }
+    }
+
+    incomingWall_ = -1;
+    if (wall >= 0 && leg_.count >= BOUNCE_FIT_SAMPLES) {
+        incoming_ = leg_;
+        incomingWall_ = wall;
+        incomingHit_ = hitTime;
+    }
+    return sampled;
+}
+
+// Compares the legs on both sides of a wall contact, both extrapolated to the contact time
+bool PhysicsEstimator::sampleBounce() {
+    int wall = incomingWall_;
+    incomingWall_ = -1;
+
+    cv::Point2f positionIn, velocityIn, positionOut, velocityOut;
+    double midIn = incoming_.duration / 2.0;
+    double midOut = leg_.duration / 2.0;
+    if (!incoming_.linear(midIn, positionIn, velocityIn) || !leg_.linear(midOut, positionOut, velocityOut)) return false;
+
+    double contactIn = incomingHit_;
+    double contactOut = contactIn - ((int64_t)leg_.t0 - (int64_t)incoming_.t0) / 1000000.0;
+    double decay = getGlideDecay();
+    cv::Point2f in = velocityIn * (float)std::exp(-decay * (contactIn - midIn));
+    cv::Point2f out = velocityOut * (float)std::exp(decay * (midOut - contactOut));
+    cv::Point2f contact = positionOut + velocityOut * (float)(contactOut - midOut);
+
+    bool alongX = wall < 2;
+    double normalIn = alongX ? in.x : in.y;
+    double normalOut = alongX ? out.x : out.y;
+    double tangentialChange = alongX ? out.y - in.y : out.x - in.x;
+    double contactError = (alongX ? contact.x : contact.y) - config_.wallCoordinate(wall);
+
+    // Anything else (mallet near the wall, missed detections) changes more than the normal speed
+    if (std::abs(normalIn) < MIN_NORMAL_SPEED || normalIn * normalOut >= 0.0) return false;
+    if (std::abs(contactError) > CONTACT_TOLERANCE_MM) return false;
+    if (std::abs(tangentialChange) > TANGENTIAL_TOLERANCE * cv::norm(in)) return false;
+    double restitution = std::abs(normalOut / normalIn);
+    if (restitution < MIN_RESTITUTION || restitution > MAX_RESTITUTION) return false;
+
+    restitutionSum_[wall] += restitution;
+    bounceCount_[wall]++;
+    return true;
+}
+
+double PhysicsEstimator::getRestitution(int wall) const {
+    if (bounceCount_[wall] > 0) return restitutionSum_[wall] / bounceCount_[wall];
+    return config_.wallRestitution(wall);
+}
+
+double PhysicsEstimator::getGlideDecay() const {
+    if (glideCount_ < config_.PHYSICS_MIN_SAMPLES || decayWeight_ <= 0.0) return config_.GLIDE_DECAY;
+    return std::max(0.0, decaySum_ / decayWeight_);
+}
+
+// Only the estimates with enough samples, as config.json keys; the live config is never changed
+bool PhysicsEstimator::saveEstimates(const std::string& filename) const {
+    static const char* keys[4] = {"WALL_RESTITUTION_X_MIN", "WALL_RESTITUTION_X_MAX", "WALL_RESTITUTION_Y_MIN", "WALL_RESTITUTION_Y_MAX"};
+    nlohmann::json j = nlohmann::json::object();
+    for (int wall = 0; wall < 4; ++wall) {
+        if (bounceCount_[wall] >= config_.PHYSICS_MIN_SAMPLES) j[keys[wall]] = (float)getRestitution(wall);
+    }
+    if (glideCount_ >= config_.PHYSICS_MIN_SAMPLES) j["GLIDE_DECAY"] = (float)getGlideDecay();
+    if (j.empty()) return false;
+
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error saving table physics to " << filename << std::endl;
+        return false;
+    }
+    file << j.dump(4);
+    return true;
+}
+
+void PhysicsEstimator::print(std::ostream& out) const {
+    static const char* names[4] = {"x min", "x max", "y min", "y max"};
+    out << "Table physics:";
+    for (int wall = 0; wall < 4; ++wall) {
+        out << " " << names[wall] << " " << getRestitution(wall) << " (" << bounceCount_[wall] << ")";
+    }
+    out << ", glide decay " << getGlideDecay() << " 1/s (" << glideCount_ << ")" << std::endl;
+}
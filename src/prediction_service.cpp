@@ -0,0 +1,120 @@
+#include "prediction_service.hpp"
+#include "latency.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+PredictionService::PredictionService(const Config& config, const TrajectoryPredictor& predictor, MovementController& mover)
+    : config_(config), predictor_(predictor), mover_(mover), stopping_(false), lastAttemptVersion_(0), hasCommand_(false),
+      hasPrePosition_(false), prePositionRequestUs_(0) {}
+
+PredictionService::~PredictionService() {
+    stop();
+}
+
+void PredictionService::start() {
+    if (isRunning() || config_.PREDICTION_SERVICE_RATE_HZ <= 0.0f) return;
+    stopping_ = false;
+    thread_ = std::thread(&PredictionService::run, this);
+    std::cout << "Prediction service running at " << config_.PREDICTION_SERVICE_RATE_HZ << " Hz" << std::endl;
+}
+
+void PredictionService::stop() {
+    if (!isRunning()) return;
+    stopping_ = true;
+    thread_.join();
+}
+
+bool PredictionService::takeCommand(PredictionServiceCommand& command) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!hasCommand_) return false;
+    command = command_;
+    hasCommand_ = false;
+    return true;
+}
+
+void PredictionService::requestPrePosition(const cv::Point2f& tableTarget) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hasPrePosition_ = true;
+    prePositionTarget_ = tableTarget;
+    prePositionRequestUs_ = LatencyTracker::nowUs();
+}
+
+PredictionServiceStatistics PredictionService::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// Fixed-rate schedule on the steady clock. A tick that wakes more than a period late counts
+// as an overrun and restarts the schedule from now instead of firing the missed ticks back to back.
+void PredictionService::run() {
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / config_.PREDICTION_SERVICE_RATE_HZ));
+    Clock::time_point next = Clock::now();
+    while (!stopping_) {
+        std::this_thread::sleep_until(next);
+        Clock::time_point woke = Clock::now();
+        tick(LatencyTracker::nowUs());
+
+        double latenessUs = std::chrono::duration<double, std::micro>(woke - next).count();
+        bool overrun = woke - next > period;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.ticks++;
+            stats_.maxLatenessUs = std::max(stats_.maxLatenessUs, latenessUs);
+            if (overrun) stats_.overruns++;
+        }
+        next = overrun ? woke + period : next + period;
+    }
+}
+
+void PredictionService::tick(uint64_t nowUs) {
+    PredictorSnapshot snapshot = predictor_.getSnapshot();
+    bool hasPrePosition;
+    cv::Point2f prePosition;
+    uint64_t prePositionRequestUs;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hasPrePosition = hasPrePosition_;
+        prePosition = prePositionTarget_;
+        prePositionRequestUs = prePositionRequestUs_;
+        hasPrePosition_ = false;
+    }
+    if (!snapshot.initialized) return;
+    if (!snapshot.entry.valid) {
+        if (hasPrePosition) send(prePosition, nowUs, prePositionRequestUs, true);
+        return;
+    }
+    if (snapshot.version == lastAttemptVersion_) return;
+
+    // Judge the puck where it will be when a command sent now moves the robot
+    uint64_t actionTimeUs = nowUs + (uint64_t)(config_.ACTUATION_DELAY_MS * 1000.0);
+    cv::Point2f puck = snapshot.predictPosition(actionTimeUs);
+    if (puck.x < 0 || puck.y < 0) return;
+    cv::Point2f velocity = snapshot.predictVelocity(actionTimeUs);
+
+    // Zone frame: y is the depth from the goal line, growing into the table
+    if (snapshot.zoneFrame.mapVector(velocity).y > 0) return;  // moving away (already hit back)
+    if (std::hypot(velocity.x, velocity.y) < MIN_SPEED_FOR_ROBOT_MM_S) return;
+    if (snapshot.zoneFrame.map(puck).y < config_.DEFENSE_ZONE_HEIGHT + DEFENSE_ZONE_BUFFER_MM) return;  // in or near the zone
+
+    lastAttemptVersion_ = snapshot.version;
+    send(snapshot.target, nowUs, snapshot.publishedUs, false);
+}
+
+// nowUs: the tick that decided to send; sinceUs: when the target became available
+void PredictionService::send(const cv::Point2f& tableTarget, uint64_t nowUs, uint64_t sinceUs, bool prePosition) {
+    cv::Point2f robotTarget = mover_.TableToRobotCoordinates(tableTarget);
+    if (!mover_.moveTo(robotTarget)) return;
+    uint64_t sentUs = LatencyTracker::nowUs();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.commands++;
+    hasCommand_ = true;
+    command_.tableTarget = tableTarget;
+    command_.robotTarget = robotTarget;
+    command_.sendLatencyUs = sentUs > nowUs ? (double)(sentUs - nowUs) : 0.0;
+    command_.holdUs = nowUs > sinceUs ? (double)(nowUs - sinceUs) : 0.0;
+    stats_.maxHoldUs = std::max(stats_.maxHoldUs, command_.holdUs);
+    command_.prePosition = prePosition;
+}
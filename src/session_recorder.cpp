@@ -0,0 +1,380 @@
+#include "session_recorder.hpp"
+#include <cstring>
+#include <iostream>
+
+namespace {
+const char SESSION_MAGIC[4] = {'A', 'H', 'R', 'S'};
+const uint32_t SESSION_VERSION = 1;
+const uint8_t CHUNK_BACKGROUND = 'B';
+const uint8_t CHUNK_FRAME = 'F';
+const uint8_t CHUNK_KEYFRAME = 'K';
+const uint8_t CHUNK_RAW_KEYFRAME = 'R';  // only lives in the in-memory buffer, encoded to 'K' by the writer
+const size_t CHUNK_HEADER_SIZE = 1 + sizeof(uint32_t);
+
+const uint8_t FLAG_FILTER_VALID = 1 << 0;
+const uint8_t FLAG_COMMAND_SENT = 1 << 1;
+const uint8_t FLAG_KEYFRAME_FOLLOWS = 1 << 2;
+
+const int COVARIANCE_TERMS = 10;  // upper triangle of the symmetric 4x4 covariance
+const uint32_t MAX_CHUNK_SIZE = 64u << 20;  // larger sizes in a session file mean it is corrupt
+
+// Part of a patch rectangle that lies inside an image of the given size
+cv::Rect clipToImage(const cv::Rect& rect, const cv::Size& size) {
+    return rect & cv::Rect(0, 0, size.width, size.height);
+}
+}
+
+SessionRecorder::SessionRecorder(const Config& config) : config_(config), file_(nullptr), used_{0, 0}, active_(0), pending_(-1), stopping_(false), recordedFrames_(0), droppedFrames_(0), framesSinceKeyframe_(0) {}
+
+SessionRecorder::~SessionRecorder() {
+    close();
+}
+
+bool SessionRecorder::open(const std::string& filename, const cv::Mat& background) {
+    if (file_) close();
+    if (background.empty() || background.channels() != 1) {
+        std::cerr << "Error: Session background must be a grayscale frame" << std::endl;
+        return false;
+    }
+
+    file_ = std::fopen(filename.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Error: Could not open session file for writing: " << filename << std::endl;
+        return false;
+    }
+
+    // Preallocate both stream buffers up front so recording never allocates in the loop
+    size_t capacity = (size_t)std::max(1, config_.SESSION_BUFFER_MB) * 1024 * 1024;
+    for (int i = 0; i < 2; ++i) {
+        buffers_[i].resize(capacity);
+        used_[i] = 0;
+    }
+    active_ = 0;
+    pending_ = -1;
+    stopping_ = false;
+    recordedFrames_ = 0;
+    droppedFrames_ = 0;
+    framesSinceKeyframe_ = 0;
+
+    std::fwrite(SESSION_MAGIC, 1, sizeof(SESSION_MAGIC), file_);
+    std::fwrite(&SESSION_VERSION, sizeof(SESSION_VERSION), 1, file_);
+
+    std::vector<uint8_t> png;
+    cv::imencode(".png", background, png);
+    uint64_t timestamp = (uint64_t)(cv::getTickCount() / cv::getTickFrequency() * 1000000.0);
+    uint32_t size = (uint32_t)(sizeof(timestamp) + png.size());
+    std::fwrite(&CHUNK_BACKGROUND, 1, 1, file_);
+    std::fwrite(&size, sizeof(size), 1, file_);
+    std::fwrite(&timestamp, sizeof(timestamp), 1, file_);
+    std::fwrite(png.data(), 1, png.size(), file_);
+
+    writer_ = std::thread(&SessionRecorder::writerLoop, this);
+    std::cout << "Recording session to " << filename << std::endl;
+    return true;
+}
+
+template <typename T>
+void SessionRecorder::put(const T& value) {
+    putBytes(&value, sizeof(T));
+}
+
+void SessionRecorder::putBytes(const void* data, size_t size) {
+    std::memcpy(buffers_[active_].data() + used_[active_], data, size);
+    used_[active_] += size;
+}
+
+// Make room for size bytes in the active buffer, handing a full buffer to the writer.
+// Never blocks: if the writer is still busy with the other buffer the frame is dropped.
+bool SessionRecorder::reserve(size_t size) {
+    if (size > buffers_[active_].size()) return false;
+    if (used_[active_] + size <= buffers_[active_].size()) return true;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_ >= 0) return false;
+    pending_ = active_;
+    active_ = 1 - active_;
+    cv_.notify_all();
+    return true;
+}
+
+// Frame chunk payload:
+//   uint64 timestamp, uint8 flags, float commandX, commandY,
+//   [4 doubles state, 10 doubles covariance upper triangle] if filter valid,
+//   uint8 detection count, per detection:
+//     uint8 kind, uint64 timestamp, float imageX, imageY, tableX, tableY,
+//     uint16 patchX, patchY, patchW, patchH, patchW*patchH gray bytes
+void SessionRecorder::recordFrame(const cv::Mat& grayFrame, SessionFrameRecord& record) {
+    if (!file_ || grayFrame.empty() || grayFrame.channels() != 1) return;
+
+    const int radius = config_.SESSION_PATCH_RADIUS;
+    const cv::Rect frameRect(0, 0, grayFrame.cols, grayFrame.rows);
+    size_t detectionCount = std::min<size_t>(record.detections.size(), 255);
+
+    size_t payload = sizeof(uint64_t) + 1 + 2 * sizeof(float) + 1;
+    if (record.filterValid) payload += (4 + COVARIANCE_TERMS) * sizeof(double);
+    for (size_t i = 0; i < detectionCount; ++i) {
+        SessionDetection& d = record.detections[i];
+        d.patchRect = cv::Rect((int)d.image.x - radius, (int)d.image.y - radius, 2 * radius, 2 * radius) & frameRect;
+        payload += 1 + sizeof(uint64_t) + 4 * sizeof(float) + 4 * sizeof(uint16_t) + d.patchRect.area();
+    }
+
+    bool keyframe = framesSinceKeyframe_ == 0 || (int)framesSinceKeyframe_ >= config_.SESSION_KEYFRAME_INTERVAL;
+    size_t keyframePayload = sizeof(uint64_t) + 2 * sizeof(uint16_t) + grayFrame.total();
+    size_t total = CHUNK_HEADER_SIZE + payload + (keyframe ? CHUNK_HEADER_SIZE + keyframePayload : 0);
+    if (!reserve(total)) {
+        droppedFrames_++;
+        return;
+    }
+
+    uint8_t flags = 0;
+    if (record.filterValid) flags |= FLAG_FILTER_VALID;
+    if (record.commandSent) flags |= FLAG_COMMAND_SENT;
+    if (keyframe) flags |= FLAG_KEYFRAME_FOLLOWS;
+
+    put(CHUNK_FRAME);
+    put((uint32_t)payload);
+    put(record.timestampUs);
+    put(flags);
+    put(record.commandTarget.x);
+    put(record.commandTarget.y);
+    if (record.filterValid) {
+        putBytes(record.filterState, 4 * sizeof(double));
+        for (int r = 0; r < 4; ++r) {
+            for (int c = r; c < 4; ++c) put(record.filterCovariance[r * 4 + c]);
+        }
+    }
+    put((uint8_t)detectionCount);
+    for (size_t i = 0; i < detectionCount; ++i) {
+        const SessionDetection& d = record.detections[i];
+        put(d.kind);
+        put(d.timestampUs);
+        put(d.image.x);
+        put(d.image.y);
+        put(d.table.x);
+        put(d.table.y);
+        put((uint16_t)d.patchRect.x);
+        put((uint16_t)d.patchRect.y);
+        put((uint16_t)d.patchRect.width);
+        put((uint16_t)d.patchRect.height);
+        for (int row = 0; row < d.patchRect.height; ++row) {
+            putBytes(grayFrame.ptr(d.patchRect.y + row) + d.patchRect.x, d.patchRect.width);
+        }
+    }
+
+    if (keyframe) {
+        // Stored raw here, JPEG encoding happens on the writer thread
+        put(CHUNK_RAW_KEYFRAME);
+        put((uint32_t)keyframePayload);
+        put(record.timestampUs);
+        put((uint16_t)grayFrame.cols);
+        put((uint16_t)grayFrame.rows);
+        for (int row = 0; row < grayFrame.rows; ++row) {
+            putBytes(grayFrame.ptr(row), grayFrame.cols);
+        }
+        framesSinceKeyframe_ = 0;
+    }
+    framesSinceKeyframe_++;
+    recordedFrames_++;
+}
+
+void SessionRecorder::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return pending_ >= 0 || stopping_; });
+        if (pending_ >= 0) {
+            int index = pending_;
+            lock.unlock();
+            writeBuffer(buffers_[index], used_[index]);
+            used_[index] = 0;
+            lock.lock();
+            pending_ = -1;
+            cv_.notify_all();
+            continue;
+        }
+        if (stopping_) break;
+    }
+}
+
+// Write a buffer sequentially, encoding raw keyframes on the way
+void SessionRecorder::writeBuffer(const std::vector<uint8_t>& buffer, size_t used) {
+    size_t runStart = 0;
+    size_t pos = 0;
+    while (pos + CHUNK_HEADER_SIZE <= used) {
+        uint8_t type = buffer[pos];
+        uint32_t size;
+        std::memcpy(&size, &buffer[pos + 1], sizeof(size));
+        size_t next = pos + CHUNK_HEADER_SIZE + size;
+        if (type == CHUNK_RAW_KEYFRAME) {
+            std::fwrite(buffer.data() + runStart, 1, pos - runStart, file_);
+
+            const uint8_t* p = buffer.data() + pos + CHUNK_HEADER_SIZE;
+            uint64_t timestamp;
+            uint16_t width, height;
+            std::memcpy(&timestamp, p, sizeof(timestamp));
+            std::memcpy(&width, p + sizeof(timestamp), sizeof(width));
+            std::memcpy(&height, p + sizeof(timestamp) + sizeof(width), sizeof(height));
+            cv::Mat raw(height, width, CV_8UC1, (void*)(p + sizeof(timestamp) + 2 * sizeof(uint16_t)));
+            std::vector<uint8_t> jpeg;
+            cv::imencode(".jpg", raw, jpeg, {cv::IMWRITE_JPEG_QUALITY, 90});
+
+            uint32_t encodedSize = (uint32_t)(sizeof(timestamp) + jpeg.size());
+            std::fwrite(&CHUNK_KEYFRAME, 1, 1, file_);
+            std::fwrite(&encodedSize, sizeof(encodedSize), 1, file_);
+            std::fwrite(&timestamp, sizeof(timestamp), 1, file_);
+            std::fwrite(jpeg.data(), 1, jpeg.size(), file_);
+            runStart = next;
+        }
+        pos = next;
+    }
+    std::fwrite(buffer.data() + runStart, 1, used - runStart, file_);
+}
+
+void SessionRecorder::close() {
+    if (!file_) return;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return pending_ < 0; });
+        if (used_[active_] > 0) pending_ = active_;
+        stopping_ = true;
+        cv_.notify_all();
+    }
+    writer_.join();
+    std::fclose(file_);
+    file_ = nullptr;
+    std::cout << "Session closed: " << recordedFrames_ << " frames recorded, " << droppedFrames_ << " dropped" << std::endl;
+}
+
+bool SessionReader::open(const std::string& filename) {
+    close();
+    file_ = std::fopen(filename.c_str(), "rb");
+    if (!file_) {
+        std::cerr << "Error: Could not open session file: " << filename << std::endl;
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0;
+    if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) || std::memcmp(magic, SESSION_MAGIC, sizeof(magic)) != 0 ||
+        std::fread(&version, sizeof(version), 1, file_) != 1 || version != SESSION_VERSION) {
+        std::cerr << "Error: Not a session file (or unsupported version): " << filename << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SessionReader::readChunk(uint8_t& type, std::vector<uint8_t>& payload) {
+    uint32_t size;
+    if (std::fread(&type, 1, 1, file_) != 1) return false;  // end of file
+    if (std::fread(&size, sizeof(size), 1, file_) != 1 || size > MAX_CHUNK_SIZE) {
+        std::cerr << "Error: Corrupt or truncated session file" << std::endl;
+        return false;
+    }
+    payload.resize(size);
+    if (std::fread(payload.data(), 1, size, file_) != size) {
+        std::cerr << "Error: Truncated session file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Every read is checked against the chunk size: a truncated or corrupt file ends the replay
+// with an error, and patches are clipped to the background they are pasted into
+bool SessionReader::next(SessionFrameRecord& record, cv::Mat& frame) {
+    if (!file_) return false;
+
+    auto corrupt = []() {
+        std::cerr << "Error: Corrupt session chunk" << std::endl;
+        return false;
+    };
+    uint8_t type;
+    while (readChunk(type, payload_)) {
+        if (type == CHUNK_BACKGROUND) {
+            if (payload_.size() <= sizeof(uint64_t)) return corrupt();
+            std::vector<uint8_t> png(payload_.begin() + sizeof(uint64_t), payload_.end());
+            background_ = cv::imdecode(png, cv::IMREAD_GRAYSCALE);
+            continue;
+        }
+        if (type != CHUNK_FRAME) continue;
+
+        const uint8_t* p = payload_.data();
+        size_t remaining = payload_.size();
+        auto get = [&p, &remaining](void* out, size_t size) {
+            if (size > remaining) return false;
+            std::memcpy(out, p, size);
+            p += size;
+            remaining -= size;
+            return true;
+        };
+
+        uint8_t flags;
+        if (!get(&record.timestampUs, sizeof(record.timestampUs)) || !get(&flags, sizeof(flags)) ||
+            !get(&record.commandTarget.x, sizeof(float)) || !get(&record.commandTarget.y, sizeof(float))) return corrupt();
+        record.filterValid = (flags & FLAG_FILTER_VALID) != 0;
+        record.commandSent = (flags & FLAG_COMMAND_SENT) != 0;
+        if (record.filterValid) {
+            if (!get(record.filterState, 4 * sizeof(double))) return corrupt();
+            bool complete = true;
+            for (int r = 0; r < 4 && complete; ++r) {
+                for (int c = r; c < 4 && complete; ++c) {
+                    complete = get(&record.filterCovariance[r * 4 + c], sizeof(double));
+                    record.filterCovariance[c * 4 + r] = record.filterCovariance[r * 4 + c];
+                }
+            }
+            if (!complete) return corrupt();
+        }
+
+        frame = background_.empty() ? cv::Mat() : background_.clone();
+        uint8_t count;
+        if (!get(&count, sizeof(count))) return corrupt();
+        record.detections.resize(count);
+        for (uint8_t i = 0; i < count; ++i) {
+            SessionDetection& d = record.detections[i];
+            uint16_t rect[4];
+            bool complete = get(&d.kind, sizeof(d.kind)) && get(&d.timestampUs, sizeof(d.timestampUs)) &&
+                            get(&d.image.x, sizeof(float)) && get(&d.image.y, sizeof(float)) &&
+                            get(&d.table.x, sizeof(float)) && get(&d.table.y, sizeof(float)) && get(rect, sizeof(rect));
+            if (!complete) return corrupt();
+            d.patchRect = cv::Rect(rect[0], rect[1], rect[2], rect[3]);
+            size_t patchBytes = (size_t)d.patchRect.width * d.patchRect.height;
+            if (patchBytes > remaining) return corrupt();
+            cv::Rect inside = clipToImage(d.patchRect, frame.size());
+            for (int row = inside.y; row < inside.y + inside.height; ++row) {
+                const uint8_t* src = p + (size_t)(row - d.patchRect.y) * d.patchRect.width + (inside.x - d.patchRect.x);
+                std::memcpy(frame.ptr(row) + inside.x, src, inside.width);
+            }
+            p += patchBytes;
+            remaining -= patchBytes;
+        }
+
+        if (flags & FLAG_KEYFRAME_FOLLOWS) {
+            uint8_t keyType;
+            if (readChunk(keyType, payload_) && keyType == CHUNK_KEYFRAME && payload_.size() > sizeof(uint64_t)) {
+                std::vector<uint8_t> jpeg(payload_.begin() + sizeof(uint64_t), payload_.end());
+                cv::Mat key = cv::imdecode(jpeg, cv::IMREAD_GRAYSCALE);
+                if (!key.empty()) {
+                    // Refresh the background from the keyframe, except where the detections are
+                    cv::Mat refreshed = key.clone();
+                    if (!background_.empty() && background_.size() == key.size()) {
+                        for (const auto& d : record.detections) {
+                            cv::Rect inside = clipToImage(d.patchRect, key.size());
+                            if (inside.area() == 0) continue;
+                            cv::Mat dst = refreshed(inside);
+                            background_(inside).copyTo(dst);
+                        }
+                    }
+                    background_ = refreshed;
+                    frame = key;
+                }
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void SessionReader::close() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
@@ -0,0 +1,115 @@
+#include "smoother.hpp"
+#include <algorithm>
+
+namespace {
+
+// One RTS step: smoothed state at k from the smoothed state at k + 1. Returns the gain C.
+KalmanFilter::StateMatrix rtsStep(const KalmanFilter::StateVector& filtered, const KalmanFilter::StateMatrix& filteredCov,
+                                  const KalmanFilter::StateVector& predicted, const KalmanFilter::StateMatrix& predictedCov,
+                                  const KalmanFilter::StateMatrix& transition,
+                                  KalmanFilter::StateVector& state, KalmanFilter::StateMatrix& cov) {
+    // C = Pf F^T Ppred^-1, computed as (Ppred^-1 F Pf)^T since both covariances are symmetric
+    KalmanFilter::StateMatrix gain = predictedCov.ldlt().solve(transition * filteredCov).transpose();
+    state = filtered + gain * (state - predicted);
+    cov = filteredCov + gain * (cov - predictedCov) * gain.transpose();
+    return gain;
+}
+}
+
+TrackSmoother::TrackSmoother(const Config& config)
+    : config_(config), walls_(config) {}
+
+void TrackSmoother::smooth(const std::vector<PuckPosition>& measurements, std::vector<SmoothedState>& states, int lag) {
+    states.clear();
+    predictedState_.clear();
+    predictedCov_.clear();
+    transition_.clear();
+    filteredState_.clear();
+    filteredCov_.clear();
+
+    KalmanFilter filter;
+    filter.setNoise(config_.KALMAN_POSITION_NOISE, config_.KALMAN_VELOCITY_NOISE, config_.KALMAN_MEASUREMENT_NOISE);
+    size_t trackStart = 0;
+    int track = -1;
+    int consecutiveRejects = 0;
+    for (const PuckPosition& m : measurements) {
+        KalmanFilter::MeasVector meas(m.position.x, m.position.y);
+        SmoothedState s;
+        s.timestamp = m.timestamp;
+        s.measurement = m.position;
+        s.rejected = false;
+        s.crossCovariance.setZero();
+
+        double dt = states.empty() ? 0.0 : ((int64_t)m.timestamp - (int64_t)states.back().timestamp) / 1000000.0;
+        bool newTrack = states.empty() || dt > config_.TRACK_MAX_GAP_S;
+        if (!newTrack && dt <= 0) continue;  // duplicate or out-of-order timestamp
+
+        KalmanFilter::StateMatrix transition;
+        if (!newTrack) {
+            walls_.propagate(filter, dt, config_.GLIDE_DECAY, &transition);
+            s.rejected = filter.mahalanobis(meas) > config_.GATE_REJECT_CHI2;
+            consecutiveRejects = s.rejected ? consecutiveRejects + 1 : 0;
+            // As in the live filter, a run of rejections (a hit) restarts the track
+            if (consecutiveRejects >= config_.GATE_MAX_CONSECUTIVE_REJECTS) {
+                newTrack = true;
+                s.rejected = false;
+            }
+        }
+        if (newTrack) {
+            if (!states.empty()) smoothBackward(trackStart, states.size() - 1, states, lag);
+            trackStart = states.size();
+            track++;
+            consecutiveRejects = 0;
+
+            filter.reset();
+            KalmanFilter::StateVector initialState;
+            initialState << m.position.x, m.position.y, 0, 0;
+            KalmanFilter::StateMatrix initialCov = filter.getCovariance();
+            initialCov.bottomRightCorner<2, 2>() = KalmanFilter::MeasMatrix::Identity() * KalmanFilter::ScalarType(config_.TRACK_INIT_VELOCITY_STD * config_.TRACK_INIT_VELOCITY_STD);
+            filter.setState(initialState);
+            filter.setCovariance(initialCov);
+            transition_.push_back(KalmanFilter::StateMatrix::Identity());
+        } else {
+            transition_.push_back(transition);
+        }
+
+        predictedState_.push_back(filter.getState());
+        predictedCov_.push_back(filter.getCovariance());
+        if (!newTrack && !s.rejected) filter.update(meas);
+        filteredState_.push_back(filter.getState());
+        filteredCov_.push_back(filter.getCovariance());
+
+        s.transition = transition_.back();
+        s.track = track;
+        s.state = filter.getState();
+        s.covariance = filter.getCovariance();
+        states.push_back(s);
+    }
+    if (!states.empty()) smoothBackward(trackStart, states.size() - 1, states, lag);
+}
+
+// RTS pass over states [first, last] of one track. With a lag, every state is smoothed on
+// its own from the filtered state `lag` measurements later, so it costs O(N * lag).
+void TrackSmoother::smoothBackward(size_t first, size_t last, std::vector<SmoothedState>& states, int lag) const {
+    if (lag <= 0) {
+        for (size_t k = last; k > first; --k) {
+            states[k - 1].state = states[k].state;
+            states[k - 1].covariance = states[k].covariance;
+            KalmanFilter::StateMatrix gain = rtsStep(filteredState_[k - 1], filteredCov_[k - 1], predictedState_[k], predictedCov_[k],
+                                                     transition_[k], states[k - 1].state, states[k - 1].covariance);
+            states[k].crossCovariance = states[k].covariance * gain.transpose();
+        }
+        return;
+    }
+
+    for (size_t k = first; k < last; ++k) {
+        size_t end = std::min(k + (size_t)lag, last);
+        KalmanFilter::StateVector state = filteredState_[end];
+        KalmanFilter::StateMatrix cov = filteredCov_[end];
+        for (size_t j = end; j > k; --j) {
+            rtsStep(filteredState_[j - 1], filteredCov_[j - 1], predictedState_[j], predictedCov_[j], transition_[j], state, cov);
+        }
+        states[k].state = state;
+        states[k].covariance = cov;
+    }
+}
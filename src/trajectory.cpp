@@ -1,141 +1,708 @@
 #include "trajectory.hpp"
 #include <algorithm>
+#include <cmath>
 #include <limits>
 
-TrajectoryPredictor::TrajectoryPredictor(const Config& config) : config_(config), currentZoneIndex_(config.WHERE_DEFENSE_ZONE), kalmanFilter_(), lastTimestamp_(0), initialized_(false) {
+TrajectoryPredictor::TrajectoryPredictor(const Config& config) : config_(config), currentZoneIndex_(config.WHERE_DEFENSE_ZONE), stopWall_(-1), kalmanFilter_(), estimator_((TrajectoryEstimator)config.TRAJECTORY_ESTIMATOR), lineFit_(config), lastTimestamp_(0), initialized_(false), initCount_(0),
+    history_(std::max(config.OOSM_HISTORY_LENGTH, 0), HistoryEntry(config)), historyStart_(0), historyCount_(0), trajectoryValid_(false) {
         // Defense zone bounds
     setDefenseZone(config.WHERE_DEFENSE_ZONE);
+
+    // Markov model switching: stay with IMM_MODE_STAY_PROBABILITY, otherwise switch evenly
+    double stay = config_.IMM_MODE_STAY_PROBABILITY;
+    modeTransition_.setConstant((1.0 - stay) / (MODEL_COUNT - 1));
+    modeTransition_.diagonal().setConstant(stay);
+
+    // Noise identified offline from recorded sessions; reset() keeps it
+    kalmanFilter_.setNoise(config_.KALMAN_POSITION_NOISE, config_.KALMAN_VELOCITY_NOISE, config_.KALMAN_MEASUREMENT_NOISE);
+    for (int m = 0; m < MODEL_COUNT; ++m) {
+        models_[m].setNoise(config_.KALMAN_POSITION_NOISE, config_.KALMAN_VELOCITY_NOISE, config_.KALMAN_MEASUREMENT_NOISE);
+    }
+    configureModels();
+    replay_.reserve(history_.size());
+}
+
+void TrajectoryPredictor::configureModels() {
+    for (int m = 0; m < MODEL_COUNT; ++m) models_[m].reset();
+    KalmanFilter::StateMatrix Q = models_[MODEL_MANEUVER].getProcessNoise();
+    Q.bottomRightCorner<2, 2>() *= config_.IMM_MANEUVER_NOISE_SCALE;
+    models_[MODEL_MANEUVER].setProcessNoise(Q);
+    modeProbabilities_.setConstant(1.0 / MODEL_COUNT);
 }
 
 void TrajectoryPredictor::addMeasurement(const PuckPosition& measurement) {
+    if (historyCount_ > 0 && measurement.timestamp <= historyAt(historyCount_ - 1).measurement.timestamp) {
+        insertLateMeasurement(measurement);
+    } else {
+        applyMeasurement(measurement);
+        recordMeasurement(measurement);
+    }
+    publishSnapshot();
+}
+
+// Rewinds to the newest buffered measurement before the late one, applies it and replays the
+// newer ones on top, so the result is the same as if it had arrived in order. The cost is at
+// most one update per buffered measurement.
+void TrajectoryPredictor::insertLateMeasurement(const PuckPosition& measurement) {
+    int k = historyCount_ - 1;
+    while (k >= 0 && historyAt(k).measurement.timestamp > measurement.timestamp) --k;
+    if (k < 0 || historyAt(k).measurement.timestamp == measurement.timestamp) {
+        sequenceStats_.dropped++;
+        return;
+    }
+
+    replay_.clear();
+    for (int i = k + 1; i < historyCount_; ++i) replay_.push_back(historyAt(i).measurement);
+    restoreState(historyAt(k).state);
+    historyCount_ = k + 1;
+
+    applyMeasurement(measurement);
+    recordMeasurement(measurement);
+    for (const PuckPosition& later : replay_) {
+        applyMeasurement(later);
+        recordMeasurement(later);
+    }
+    sequenceStats_.reordered++;
+}
+
+void TrajectoryPredictor::recordMeasurement(const PuckPosition& measurement) {
+    if (history_.empty()) return;
+    if (historyCount_ == (int)history_.size()) {
+        historyStart_ = (historyStart_ + 1) % history_.size();
+        historyCount_--;
+    }
+    HistoryEntry& entry = historyAt(historyCount_++);
+    entry.measurement = measurement;
+    saveState(entry.state);
+}
+
+void TrajectoryPredictor::saveState(PredictorState& state) const {
+    state.filter = kalmanFilter_;
+    for (int m = 0; m < MODEL_COUNT; ++m) state.models[m] = models_[m];
+    state.modeProbabilities = modeProbabilities_;
+    state.gateStats = gateStats_;
+    state.eventCandidate = eventCandidate_;
+    state.eventStats = eventStats_;
+    if (estimator_ == ESTIMATOR_LINE_FIT) state.lineFit = lineFit_;
+    state.lastTimestamp = lastTimestamp_;
+    state.initialized = initialized_;
+    for (int i = 0; i < initCount_; ++i) state.initSamples[i] = initSamples_[i];
+    state.initCount = initCount_;
+}
+
+void TrajectoryPredictor::restoreState(const PredictorState& state) {
+    kalmanFilter_ = state.filter;
+    for (int m = 0; m < MODEL_COUNT; ++m) models_[m] = state.models[m];
+    modeProbabilities_ = state.modeProbabilities;
+    gateStats_ = state.gateStats;
+    eventCandidate_ = state.eventCandidate;
+    eventStats_ = state.eventStats;
+    if (estimator_ == ESTIMATOR_LINE_FIT) lineFit_ = state.lineFit;
+    lastTimestamp_ = state.lastTimestamp;
+    initialized_ = state.initialized;
+    for (int i = 0; i < state.initCount; ++i) initSamples_[i] = state.initSamples[i];
+    initCount_ = state.initCount;
+    trajectoryValid_ = false;
+}
+
+void TrajectoryPredictor::applyMeasurement(const PuckPosition& measurement) {
+    // The line fit replaces the filter; its estimate is copied into the filter state so
+    // every prediction below works from either estimator
+    if (estimator_ == ESTIMATOR_LINE_FIT) {
+        if (!lineFit_.addMeasurement(measurement.position, measurement.timestamp)) return;
+        kalmanFilter_.setState(lineFit_.getState());
+        kalmanFilter_.setCovariance(lineFit_.getCovariance());
+        lastTimestamp_ = lineFit_.getTimestamp();
+        initialized_ = true;
+        trajectoryValid_ = false;
+        return;
+    }
+
     if (!initialized_) {
         lastTimestamp_ = measurement.timestamp;
-        Eigen::VectorXd initialState(4);
+        KalmanFilter::StateVector initialState;
         initialState << measurement.position.x, measurement.position.y, 0, 0;
-        kalmanFilter_.setState(initialState);
+        // Velocity is unknown at track start: any puck speed must pass the innovation gate
+        KalmanFilter::StateMatrix initialCov = kalmanFilter_.getCovariance();
+        initialCov.bottomRightCorner<2, 2>() = KalmanFilter::MeasMatrix::Identity() * KalmanFilter::ScalarType(config_.TRACK_INIT_VELOCITY_STD * config_.TRACK_INIT_VELOCITY_STD);
+        seedTrack(initialState, initialCov);
         initialized_ = true;
+        trajectoryValid_ = false;
+        initCount_ = 0;
+        if (config_.TRACK_INIT_SAMPLES > 1) initSamples_[initCount_++] = measurement;
         return;
     }
 
-    double dt = (measurement.timestamp - lastTimestamp_) / 1000000.0;  // Convert microseconds to seconds
-    if (dt <= 0) return;  
+    double dt = (int64_t)(measurement.timestamp - lastTimestamp_) / 1000000.0;  // Convert microseconds to seconds
+    if (dt <= 0) return;
     lastTimestamp_ = measurement.timestamp;
+    trajectoryValid_ = false;
+
+    KalmanFilter::MeasVector meas(measurement.position.x, measurement.position.y);
+    KalmanFilter::MeasVector innovation;
+    cv::Point2f velocityBefore = getVelocity();
+    bool accepted;
+    if (config_.IMM_ENABLED) {
+        accepted = updateModels(dt, meas, innovation);
+    } else {
+        propagate(kalmanFilter_, dt, config_.GLIDE_DECAY);
+        innovation = meas - kalmanFilter_.getState().head<2>();
+        double noiseScale = gate(kalmanFilter_.mahalanobis(meas));
+        accepted = noiseScale > 0.0;
+        if (accepted) kalmanFilter_.update(meas, noiseScale);
+    }
+    if (detectEvent(measurement, innovation, velocityBefore)) return;
+
+    // For the first detections of a track, a straight-line fit through all of them so far
+    // replaces the filter estimate, which still carries the zero-velocity start
+    if (accepted && initCount_ > 0) {
+        initSamples_[initCount_++] = measurement;
+        fitInitialTrack();
+        if (initCount_ >= std::min(config_.TRACK_INIT_SAMPLES, (int)MAX_INIT_SAMPLES)) initCount_ = 0;
+    }
 
-    // Update F with dt
-    Eigen::MatrixXd F(4, 4);
-    F << 1, 0, dt, 0,
-         0, 1, 0, dt,
-         0, 0, 1, 0,
-         0, 0, 0, 1;
-    kalmanFilter_.setF(F);
+    // A run of rejections means the track itself is wrong (puck picked up, missed hit): restart it
+    if (!accepted && gateStats_.consecutiveRejects >= config_.GATE_MAX_CONSECUTIVE_REJECTS) {
+        resetTrack();
+        applyMeasurement(measurement);
+        gateStats_.reinitialized++;
+        gateStats_.consecutiveRejects = 0;
+        gateStats_.lastResult = GATE_REINITIALIZED;
+    }
+}
+
+// Innovation-based event detection. One detection beyond EVENT_CHI2 may be an outlier; a
+// second one in a row that moves further off the same way means the motion itself changed.
+// Only the kinematic state restarts, from the first detection after the event with the
+// velocity uncertain by EVENT_VELOCITY_STD, filtered with the second. The model
+// probabilities, gate statistics and history of the track are kept, where
+// GATE_MAX_CONSECUTIVE_REJECTS would start from cold. Returns true when an event was found.
+bool TrajectoryPredictor::detectEvent(const PuckPosition& measurement, const KalmanFilter::MeasVector& innovation, const cv::Point2f& velocity) {
+    if (!config_.EVENT_DETECTION_ENABLED || initCount_ > 0 || gateStats_.lastDistance <= config_.EVENT_CHI2) {
+        eventCandidate_.valid = false;
+        return false;
+    }
+    if (!eventCandidate_.valid || innovation.dot(eventCandidate_.innovation) < eventCandidate_.innovation.squaredNorm()) {
+        eventCandidate_.valid = true;
+        eventCandidate_.measurement = measurement;
+        eventCandidate_.innovation = innovation;
+        eventCandidate_.velocity = velocity;
+        return false;
+    }
 
-    Eigen::VectorXd meas(2);
-    meas << measurement.position.x, measurement.position.y;
-    kalmanFilter_.predict();
-    kalmanFilter_.update(meas);
+    TrajectoryEvent event;
+    event.timestamp = eventCandidate_.measurement.timestamp;
+    event.position = eventCandidate_.measurement.position;
+    event.distance = gateStats_.lastDistance;
+    event.velocityBefore = eventCandidate_.velocity;
+
+    KalmanFilter filter = kalmanFilter_;
+    KalmanFilter::StateVector restart;
+    restart << event.position.x, event.position.y, event.velocityBefore.x, event.velocityBefore.y;
+    KalmanFilter::StateMatrix cov = KalmanFilter::StateMatrix::Zero();
+    cov.topLeftCorner<2, 2>() = filter.getMeasurementNoise();
+    cov.bottomRightCorner<2, 2>() = KalmanFilter::MeasMatrix::Identity() * KalmanFilter::ScalarType(config_.EVENT_VELOCITY_STD * config_.EVENT_VELOCITY_STD);
+    filter.setState(restart);
+    filter.setCovariance(cov);
+    propagate(filter, ((int64_t)measurement.timestamp - (int64_t)eventCandidate_.measurement.timestamp) / 1000000.0, config_.GLIDE_DECAY);
+    filter.update(KalmanFilter::MeasVector(measurement.position.x, measurement.position.y));
+    KalmanFilter::StateVector state = filter.getState();
+    event.velocityAfter = cv::Point2f(state(2), state(3));
+
+    // Classify: below EVENT_STOP_SPEED a stop, a reversed normal velocity next to a wall a
+    // bounce, anything else a hit. A stop too noisy to resolve in two frames counts as a slow
+    // hit; its velocity keeps the restart covariance and settles over the next frames.
+    if (cv::norm(event.velocityAfter) < config_.EVENT_STOP_SPEED) {
+        event.type = EVENT_STOP;
+        event.velocityAfter = cv::Point2f(0, 0);
+        state(2) = state(3) = 0.0;
+    } else {
+        event.type = EVENT_HIT;
+        for (int wall = 0; wall < 4; ++wall) {
+            int axis = wall < 2 ? 0 : 1;
+            double coordinate = axis == 0 ? event.position.x : event.position.y;
+            double normalBefore = axis == 0 ? event.velocityBefore.x : event.velocityBefore.y;
+            double normalAfter = axis == 0 ? event.velocityAfter.x : event.velocityAfter.y;
+            bool intoWall = wall % 2 == 0 ? normalBefore < 0.0 : normalBefore > 0.0;
+            if (intoWall && normalBefore * normalAfter < 0.0 && std::abs(coordinate - config_.wallCoordinate(wall)) <= config_.EVENT_WALL_MARGIN) {
+                event.type = EVENT_BOUNCE;
+                event.wall = wall;
+                break;
+            }
+        }
+    }
+    seedTrack(state, filter.getCovariance());
+    trajectoryValid_ = false;
+
+    switch (event.type) {
+        case EVENT_BOUNCE: eventStats_.bounces++; break;
+        case EVENT_HIT: eventStats_.hits++; break;
+        default: eventStats_.stops++; break;
+    }
+    eventStats_.last = event;
+    eventCandidate_.valid = false;
+    gateStats_.consecutiveRejects = 0;
+    return true;
+}
+
+void TrajectoryPredictor::seedTrack(const KalmanFilter::StateVector& state, const KalmanFilter::StateMatrix& covariance) {
+    kalmanFilter_.setState(state);
+    kalmanFilter_.setCovariance(covariance);
+    for (int m = 0; m < MODEL_COUNT; ++m) {
+        models_[m].setState(state);
+        models_[m].setCovariance(covariance);
+    }
+}
+
+// Least-squares position and velocity at the last initiation sample, per axis, with the
+// covariance r (A^T A)^-1 of the fit. Unlike the filter's zero-velocity start, the velocity
+// carries no prior, so it is unbiased from the second detection on. Returns false (and keeps
+// the filter estimate) when the samples are not on a straight line, e.g. across a bounce.
+bool TrajectoryPredictor::fitInitialTrack() {
+    const int n = initCount_;
+    const PuckPosition& last = initSamples_[n - 1];
+    double s1 = 0.0, s2 = 0.0, sx = 0.0, sy = 0.0, stx = 0.0, sty = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double t = ((int64_t)initSamples_[i].timestamp - (int64_t)last.timestamp) / 1000000.0;
+        s1 += t;
+        s2 += t * t;
+        sx += initSamples_[i].position.x;
+        sy += initSamples_[i].position.y;
+        stx += t * initSamples_[i].position.x;
+        sty += t * initSamples_[i].position.y;
+    }
+    double det = n * s2 - s1 * s1;
+    if (det <= 0.0) return false;
+    double vx = (n * stx - s1 * sx) / det;
+    double vy = (n * sty - s1 * sy) / det;
+    double x = (sx - vx * s1) / n;
+    double y = (sy - vy * s1) / n;
+
+    const double r = kalmanFilter_.getMeasurementNoise()(0, 0);
+    double residual = 0.0;
+    for (int i = 0; i < n; ++i) {
+        double t = ((int64_t)initSamples_[i].timestamp - (int64_t)last.timestamp) / 1000000.0;
+        double ex = initSamples_[i].position.x - (x + vx * t);
+        double ey = initSamples_[i].position.y - (y + vy * t);
+        residual += (ex * ex + ey * ey) / r;
+    }
+    if (n > 2 && residual > config_.GATE_CHI2 * (n - 2)) return false;
+
+    KalmanFilter::StateVector state;
+    state << x, y, vx, vy;
+    KalmanFilter::StateMatrix cov = KalmanFilter::StateMatrix::Zero();
+    cov(0, 0) = cov(1, 1) = r * s2 / det;
+    cov(0, 2) = cov(2, 0) = cov(1, 3) = cov(3, 1) = -r * s1 / det;
+    cov(2, 2) = cov(3, 3) = r * n / det;
+    seedTrack(state, cov);
+    trajectoryValid_ = false;
+    return true;
 }
 
-cv::Point2f TrajectoryPredictor::predictPosition(uint64_t futureTimestamp) {
-    if (!initialized_) return cv::Point2f(-1, -1);
+// Chi-square gate on the squared Mahalanobis distance of the innovation. Returns the factor
+// to scale the measurement noise by, or 0 to reject the measurement.
+double TrajectoryPredictor::gate(double distance) {
+    gateStats_.lastDistance = distance;
+    if (!config_.GATE_ENABLED || distance <= config_.GATE_CHI2) {
+        gateStats_.accepted++;
+        gateStats_.consecutiveRejects = 0;
+        gateStats_.lastResult = GATE_ACCEPTED;
+        return 1.0;
+    }
+    if (distance <= config_.GATE_REJECT_CHI2) {
+        // Inflate R so the measurement pulls the state as if it sat on the gate
+        gateStats_.downweighted++;
+        gateStats_.consecutiveRejects = 0;
+        gateStats_.lastResult = GATE_DOWNWEIGHTED;
+        return distance / config_.GATE_CHI2;
+    }
+    gateStats_.rejected++;
+    gateStats_.consecutiveRejects++;
+    gateStats_.lastResult = GATE_REJECTED;
+    return 0.0;
+}
+
+// Time until the puck centre reaches the next wall along its path. With a velocity decay k
+// the travelled distance saturates at |v|/k, so walls beyond that are never reached.
+bool TrajectoryPredictor::nextWallHit(double x, double y, double vx, double vy, double decay, double& tHit, int& wall) const {
+    auto timeToTravel = [&](double distance, double speed) {
+        if (distance <= 0.0) return 0.0;  // already at or past the wall
+        if (decay <= 0.0) return distance / speed;
+        double fraction = decay * distance / speed;
+        if (fraction >= 1.0) return std::numeric_limits<double>::infinity();
+        return -std::log(1.0 - fraction) / decay;
+    };
 
-    double dt = (futureTimestamp - lastTimestamp_) / 1000000.0;
-    if (dt < 0) return cv::Point2f(-1, -1);
+    tHit = std::numeric_limits<double>::infinity();
+    wall = -1;
+    if (vx < 0.0) { tHit = timeToTravel(x - config_.wallCoordinate(0), -vx); wall = 0; }
+    else if (vx > 0.0) { tHit = timeToTravel(config_.wallCoordinate(1) - x, vx); wall = 1; }
 
-    Eigen::VectorXd state = kalmanFilter_.getState();  // [x, y, vx, vy]
+    double ty = std::numeric_limits<double>::infinity();
+    int wallY = -1;
+    if (vy < 0.0) { ty = timeToTravel(y - config_.wallCoordinate(2), -vy); wallY = 2; }
+    else if (vy > 0.0) { ty = timeToTravel(config_.wallCoordinate(3) - y, vy); wallY = 3; }
+    if (ty < tHit) { tHit = ty; wall = wallY; }
+
+    return tHit != std::numeric_limits<double>::infinity();
+}
+
+// Predict step that follows the puck through wall contacts: the filter is advanced to each
+// contact, reflected there, and advanced for the rest of the interval
+void TrajectoryPredictor::propagate(KalmanFilter& filter, double dt, double decay, KalmanFilter::StateMatrix* transition) const {
+    const int maxBounces = 4;
+    if (transition) transition->setIdentity();
     double timeLeft = dt;
+    for (int bounce = 0; bounce < maxBounces; ++bounce) {
+        const KalmanFilter::StateVector& x = filter.getState();
+        double tHit;
+        int wall;
+        if (!nextWallHit(x(0), x(1), x(2), x(3), decay, tHit, wall) || tHit >= timeLeft) break;
+
+        int axis = wall < 2 ? 0 : 1;
+        filter.setTransition(tHit, decay);
+        filter.predict();
+        double restitution = config_.wallRestitution(wall);
+        filter.reflect(axis, config_.wallCoordinate(wall), restitution);
+        if (transition) {
+            *transition = filter.getTransition() * *transition;
+            transition->row(axis) *= -1.0;
+            transition->row(axis + 2) *= -restitution;
+        }
+        timeLeft -= tHit;
+    }
+    filter.setTransition(timeLeft, decay);
+    filter.predict();
+    if (transition) *transition = filter.getTransition() * *transition;
+}
+
+// One IMM cycle: mix the model estimates, run each model filter, reweight the models
+// by their measurement likelihood and combine them into kalmanFilter_. The measurement is
+// gated on the model that explains it best; a rejected one leaves the models predicted only.
+bool TrajectoryPredictor::updateModels(double dt, const KalmanFilter::MeasVector& meas, KalmanFilter::MeasVector& innovation) {
+    // Predicted model probabilities and mixing weights
+    Eigen::Vector3d predicted = modeTransition_.transpose() * modeProbabilities_;
+    Eigen::Matrix3d mixing;  // (i, j) = P(model i before | model j now)
+    for (int j = 0; j < MODEL_COUNT; ++j) {
+        for (int i = 0; i < MODEL_COUNT; ++i) {
+            mixing(i, j) = modeTransition_(i, j) * modeProbabilities_(i) / predicted(j);
+        }
+    }
+
+    KalmanFilter::StateVector mixedState[MODEL_COUNT];
+    KalmanFilter::StateMatrix mixedCov[MODEL_COUNT];
+    for (int j = 0; j < MODEL_COUNT; ++j) {
+        mixedState[j].setZero();
+        for (int i = 0; i < MODEL_COUNT; ++i) mixedState[j] += mixing(i, j) * models_[i].getState();
+        mixedCov[j].setZero();
+        for (int i = 0; i < MODEL_COUNT; ++i) {
+            KalmanFilter::StateVector d = models_[i].getState() - mixedState[j];
+            mixedCov[j] += mixing(i, j) * (models_[i].getCovariance() + d * d.transpose());
+        }
+    }
+
+    // Model-matched filtering
+    double distance = std::numeric_limits<double>::infinity();
+    for (int j = 0; j < MODEL_COUNT; ++j) {
+        models_[j].setState(mixedState[j]);
+        models_[j].setCovariance(mixedCov[j]);
+        propagate(models_[j], dt, j == MODEL_FRICTION ? config_.IMM_FRICTION_DECAY : config_.GLIDE_DECAY);
+        double modelDistance = models_[j].mahalanobis(meas);
+        if (modelDistance < distance) {
+            distance = modelDistance;
+            innovation = meas - models_[j].getState().head<2>();
+        }
+    }
+
+    double noiseScale = gate(distance);
+    if (noiseScale > 0.0) {
+        Eigen::Vector3d logWeights;
+        for (int j = 0; j < MODEL_COUNT; ++j) {
+            models_[j].update(meas, noiseScale);
+            logWeights(j) = models_[j].getLogLikelihood() + std::log(predicted(j));
+        }
+
+        // Normalize in log space, likelihoods of large innovations underflow otherwise
+        modeProbabilities_ = (logWeights.array() - logWeights.maxCoeff()).exp();
+        modeProbabilities_ /= modeProbabilities_.sum();
+    } else {
+        modeProbabilities_ = predicted;
+    }
+
+    // Combined estimate
+    KalmanFilter::StateVector state = KalmanFilter::StateVector::Zero();
+    for (int j = 0; j < MODEL_COUNT; ++j) state += modeProbabilities_(j) * models_[j].getState();
+    KalmanFilter::StateMatrix P = KalmanFilter::StateMatrix::Zero();
+    for (int j = 0; j < MODEL_COUNT; ++j) {
+        KalmanFilter::StateVector d = models_[j].getState() - state;
+        P += modeProbabilities_(j) * (models_[j].getCovariance() + d * d.transpose());
+    }
+    kalmanFilter_.setState(state);
+    kalmanFilter_.setCovariance(P);
+    return noiseScale > 0.0;
+}
+
+int TrajectoryPredictor::getMostLikelyModel() const {
+    int best;
+    modeProbabilities_.maxCoeff(&best);
+    return best;
+}
+
+int TrajectorySegments::find(double t) const {
+    const TrajectorySegment* it = std::upper_bound(segments, segments + count, t,
+        [](double value, const TrajectorySegment& segment) { return value < segment.t0; });
+    return std::max(0, (int)(it - segments) - 1);
+}
+cv::Point2f TrajectorySegments::position(double t) const {
+    const TrajectorySegment& segment = segments[find(t)];
+    double dt = t - segment.t0;
+    double travel = decay > 0.0 ? -std::expm1(-decay * dt) / decay : dt;
+    return cv::Point2f(segment.start.x + segment.velocity.x * travel, segment.start.y + segment.velocity.y * travel);
+}
+cv::Point2f TrajectorySegments::velocity(double t) const {
+    const TrajectorySegment& segment = segments[find(t)];
+    if (decay <= 0.0) return segment.velocity;
+    return segment.velocity * (float)std::exp(-decay * (t - segment.t0));
+}
+
+const TrajectorySegments& TrajectoryPredictor::getTrajectory() const {
+    if (!trajectoryValid_) buildTrajectory();
+    return trajectory_;
+}
+
+void TrajectoryPredictor::buildTrajectory() const {
+    const KalmanFilter::StateVector& state = kalmanFilter_.getState();  // [x, y, vx, vy]
     cv::Point2f pos(state(0), state(1));
     double vx = state(2), vy = state(3);
     const int maxBounces = 3; 
 
-    for (int bounce = 0; bounce < maxBounces && timeLeft > 0; ++bounce) {
-        // Calculate time to hit each boundary
-        double tx_left = (vx != 0) ? ((vx < 0) ? (0 - pos.x) / vx : 1e9) : 1e9;  // Hit left wall if moving left
-        double tx_right = (vx != 0) ? ((vx > 0) ? (config_.PHYSICAL_TABLE_WIDTH - pos.x) / vx : 1e9) : 1e9;  // Hit right wall if moving right
-        double ty_bottom = (vy != 0) ? ((vy < 0) ? (0 - pos.y) / vy : 1e9) : 1e9;  // Hit bottom wall if moving down
-        double ty_top = (vy != 0) ? ((vy > 0) ? (config_.PHYSICAL_TABLE_HEIGHT - pos.y) / vy : 1e9) : 1e9;  // Hit top wall if moving up
-
-
-        // Find the earliest hit time within remaining time
-        double t_hit = std::min({tx_left, tx_right, ty_bottom, timeLeft});
-        if (t_hit < 0 || t_hit > timeLeft) t_hit = timeLeft;  // No valid hit, just advance
-
-        // Move to hit point or end time
-        pos.x += vx * t_hit;
-        pos.y += vy * t_hit;
-        timeLeft -= t_hit;
-
-        if (timeLeft <= 0) break;  // Reached target time
-        switch (currentZoneIndex_) //prevent bouncing at the oposite side to the defense zone
-        {
-        case 0: // Left defense zone reflect velocity at boundary except for right wall
-                if (t_hit == tx_left) vx = -vx;
-                if (t_hit == ty_bottom || t_hit == ty_top) vy = -vy;
-                break;
-            break;
-        case 1: // Right defense zone
-                if (t_hit == tx_right) vx = -vx;
-                if (t_hit == ty_bottom || t_hit == ty_top) vy = -vy;
-            break;
-        case 2: // Bottom defense zone
-                if (t_hit == ty_bottom) vy = -vy;
-                if (t_hit == tx_left || t_hit == tx_right) vx = -vx;
-            break;
-        case 3: // Top defense zone
-                if (t_hit == ty_top) vy = -vy;
-                if (t_hit == tx_left || t_hit == tx_right) vx = -vx;    
-
+    const double decay = config_.GLIDE_DECAY;
+    trajectory_.count = 0;
+    trajectory_.decay = decay;
+    double t = 0.0;
+    for (int bounce = 0; bounce <= maxBounces; ++bounce) {
+        if (bounce == maxBounces) {
+            trajectory_.segments[trajectory_.count++] = {t, pos, cv::Point2f(0, 0)};
             break;
-        
-        default:
+        }
+        trajectory_.segments[trajectory_.count++] = {t, pos, cv::Point2f(vx, vy)};
+
+        double t_hit;
+        int wall;
+        if (!nextWallHit(pos.x, pos.y, vx, vy, decay, t_hit, wall)) break;  // glides on without bounces
+
+        // Move to hit point
+        double travel = decay > 0.0 ? -std::expm1(-decay * t_hit) / decay : t_hit;
+        pos.x += vx * travel;
+        pos.y += vy * travel;
+        vx *= std::exp(-decay * t_hit);
+        vy *= std::exp(-decay * t_hit);
+        t += t_hit;
+
+        // The wall opposite the defense zone ends the path: the puck leaves play there
+        if (wall == stopWall_) {
+            trajectory_.segments[trajectory_.count++] = {t, pos, cv::Point2f(0, 0)};
             break;
         }
+        if (wall < 2) vx = -vx * config_.wallRestitution(wall);
+        else vy = -vy * config_.wallRestitution(wall);
     }
 
+    entry_ = solveEntry(cv::Point2f(state(0), state(1)), cv::Point2f(state(2), state(3)));
+    if (entry_.valid) entry_.timestamp = lastTimestamp_ + (uint64_t)(entry_.timeS * 1000000.0);
+    trajectoryValid_ = true;
+}
 
-    // Clamp to bounds if still out (rare)
+namespace {
+// Clamp to bounds if still out (rare)
+cv::Point2f clampToTable(cv::Point2f pos, double width, double height) {
     if (pos.x < 0) pos.x = 0;
-    if (pos.x > config_.PHYSICAL_TABLE_WIDTH) pos.x = config_.PHYSICAL_TABLE_WIDTH;
+    if (pos.x > width) pos.x = width;
     if (pos.y < 0) pos.y = 0;
-    if (pos.y > config_.PHYSICAL_TABLE_HEIGHT) pos.y = config_.PHYSICAL_TABLE_HEIGHT;
-
+    if (pos.y > height) pos.y = height;
     return pos;
 }
+}
+
+cv::Point2f TrajectoryPredictor::predictPosition(uint64_t futureTimestamp) const {
+    if (!initialized_ || futureTimestamp < lastTimestamp_) return cv::Point2f(-1, -1);
+    cv::Point2f pos = getTrajectory().position((futureTimestamp - lastTimestamp_) / 1000000.0);
+    return clampToTable(pos, config_.PHYSICAL_TABLE_WIDTH, config_.PHYSICAL_TABLE_HEIGHT);
+}
+cv::Point2f TrajectoryPredictor::predictVelocity(uint64_t futureTimestamp) const {
+    if (!initialized_ || futureTimestamp < lastTimestamp_) return cv::Point2f(0, 0);
+    return getTrajectory().velocity((futureTimestamp - lastTimestamp_) / 1000000.0);
+}
+// Batch query for path drawing: fills positions[i] for timestamps[i], (-1, -1) where unknown
+void TrajectoryPredictor::predictPositions(const uint64_t* timestamps, cv::Point2f* positions, size_t count) const {
+    for (size_t i = 0; i < count; ++i) positions[i] = predictPosition(timestamps[i]);
+}
+
+void TrajectoryPredictor::publishSnapshot() {
+    PredictorSnapshot snapshot;
+    snapshot.initialized = initialized_;
+    snapshot.timestamp = lastTimestamp_;
+    const KalmanFilter::StateVector& state = kalmanFilter_.getState();
+    const KalmanFilter::StateMatrix& P = kalmanFilter_.getCovariance();
+    for (int i = 0; i < 4; ++i) {
+        snapshot.state[i] = state(i);
+        for (int j = 0; j < 4; ++j) snapshot.covariance[i * 4 + j] = P(i, j);
+    }
+    snapshot.zoneIndex = currentZoneIndex_;
+    snapshot.zoneXMin = zoneXMin;
+    snapshot.zoneXMax = zoneXMax;
+    snapshot.zoneYMin = zoneYMin;
+    snapshot.zoneYMax = zoneYMax;
+    snapshot.zoneFrame = zoneFrame_;
+    snapshot.tableWidth = config_.PHYSICAL_TABLE_WIDTH;
+    snapshot.tableHeight = config_.PHYSICAL_TABLE_HEIGHT;
+    if (initialized_) {
+        snapshot.trajectory = getTrajectory();
+        snapshot.entry = entry_;
+        if (entry_.valid) {
+            EntryDistribution distribution = predictEntryDistribution();
+            snapshot.target = distribution.valid ? hedgeEntry(distribution) : entry_.point;
+        }
+    }
+    snapshot.publishedUs = (uint64_t)(cv::getTickCount() / cv::getTickFrequency() * 1000000.0);
+    snapshots_.publish(snapshot);
+}
+
+PredictorSnapshot TrajectoryPredictor::getSnapshot() const {
+    PredictorSnapshot snapshot;
+    uint64_t version = snapshots_.read(snapshot);
+    snapshot.version = version;
+    return snapshot;
+}
+
+cv::Point2f PredictorSnapshot::predictPosition(uint64_t futureTimestamp) const {
+    if (!initialized || futureTimestamp < timestamp) return cv::Point2f(-1, -1);
+    cv::Point2f pos = trajectory.position((futureTimestamp - timestamp) / 1000000.0);
+    return clampToTable(pos, tableWidth, tableHeight);
+}
+cv::Point2f PredictorSnapshot::predictVelocity(uint64_t futureTimestamp) const {
+    if (!initialized || futureTimestamp < timestamp) return cv::Point2f(0, 0);
+    return trajectory.velocity((futureTimestamp - timestamp) / 1000000.0);
+}
+void PredictorSnapshot::predictPositions(const uint64_t* timestamps, cv::Point2f* positions, size_t count) const {
+    for (size_t i = 0; i < count; ++i) positions[i] = predictPosition(timestamps[i]);
+}
+double PredictorSnapshot::getVelocityConfidence() const {
+    return std::min(1.0 / (1.0 + covariance[10]), 1.0 / (1.0 + covariance[15]));
+}
+
 cv::Point2f TrajectoryPredictor::predictEntryToDefenseZone(uint64_t currentTimestamp) {
-    if (!initialized_) return cv::Point2f(-1, -1);
+    EntryPrediction entry = predictEntry();
+    return entry.valid ? entry.point : cv::Point2f(-1, -1);
+}
+EntryPrediction TrajectoryPredictor::predictEntry() const {
+    if (!initialized_) return EntryPrediction();
+    if (!trajectoryValid_) buildTrajectory();
+    return entry_;
+}
+cv::Point2f TrajectoryPredictor::predictEntryFromState(const cv::Point2f& startPos, const cv::Point2f& startVel) {
+    EntryPrediction entry = solveEntry(startPos, startVel);
+    return entry.valid ? entry.point : cv::Point2f(-1, -1);
+}
 
-    Eigen::VectorXd state = kalmanFilter_.getState();  // [x, y, vx, vy]
-    cv::Point2f pos(state(0), state(1));
-    double vx = state(2), vy = state(3);
+namespace {
+// Motion along one table axis between two walls, in travel units: with a common velocity
+// decay k both axes advance by v * u(t), u(t) = (1 - e^(-kt)) / k (u = t without decay),
+// so every leg is a straight line in u. A bounce mirrors the motion and scales the speed by
+// that wall's restitution. Legs are tabulated up to MAX_HITS regular hits, more than the
+// entry solver ever accepts.
+struct AxisMotion {
+    static const int MAX_HITS = 6;
+    double lo, hi;
+    int initialHits;  // 1 when starting beyond a wall and moving out: reflected at u = 0
+    int hits;         // regular hits tabulated
+    double hitU[MAX_HITS];
+    double legP[MAX_HITS + 1], legV[MAX_HITS + 1], legU[MAX_HITS + 1];  // start position, velocity, start travel
+
+    AxisMotion(double p, double v, double wallLo, double wallHi, double restitutionLo, double restitutionHi)
+        : lo(wallLo), hi(wallHi), initialHits(0), hits(0) {
+        if ((p < lo && v < 0.0) || (p > hi && v > 0.0)) {
+            v = -v * (v < 0.0 ? restitutionLo : restitutionHi);
+            initialHits = 1;
+        }
+        legP[0] = p;
+        legV[0] = v;
+        legU[0] = 0.0;
+        while (hits < MAX_HITS && legV[hits] != 0.0) {
+            double vk = legV[hits];
+            double wall = vk > 0.0 ? hi : lo;
+            hitU[hits] = legU[hits] + (wall - legP[hits]) / vk;
+            legP[hits + 1] = wall;
+            legV[hits + 1] = -vk * (vk > 0.0 ? restitutionHi : restitutionLo);
+            legU[hits + 1] = hitU[hits];
+            hits++;
+        }
+    }
+
+    // Regular hits strictly before u
+    int regularHitsBefore(double u) const {
+        int k = 0;
+        while (k < hits && u > hitU[k]) k++;
+        return k;
+    }
+    int hitsBefore(double u) const { return (u > 0.0 ? initialHits : 0) + regularHitsBefore(u); }
+    double hitTime(int k) const { return k < hits ? hitU[k] : std::numeric_limits<double>::infinity(); }
+    // Wall hit by regular hit k: +1 = hi, -1 = lo
+    int hitSide(int k) const { return legV[k] > 0.0 ? 1 : -1; }
+    double legVelocity(int k) const { return legV[k]; }
+    double legStart(int k) const { return legP[k]; }
+    double legStartTime(int k) const { return legU[k]; }
+
+    double position(double u) const {
+        int k = regularHitsBefore(u);
+        return legP[k] + legV[k] * (u - legU[k]);
+    }
+    double velocity(double u) const { return legV[regularHitsBefore(u)]; }
+
+    // Earliest travel >= s at which the position lies in [c0, c1], infinity if never
+    double firstTimeIn(double c0, double c1, double s) const {
+        const double inf = std::numeric_limits<double>::infinity();
+        double p = position(s);
+        if (p >= c0 && p <= c1) return s;
+        int k = regularHitsBefore(s);
+        double vs = legV[k];
+        if (vs == 0.0) return inf;
+        if (p < c0) {
+            if (c0 > hi) return inf;
+            if (vs > 0.0) return s + (c0 - p) / vs;
+            if (k >= hits) return inf;
+            return hitU[k] + (std::max(c0, lo) - lo) / legV[k + 1];  // back off the lo wall
+        }
+        if (c1 < lo) return inf;
+        if (vs < 0.0) return s + (p - c1) / -vs;
+        if (k >= hits) return inf;
+        return hitU[k] + (hi - std::min(c1, hi)) / -legV[k + 1];  // back off the hi wall
+    }
+};
+}
+
+EntryPrediction TrajectoryPredictor::solveEntry(const cv::Point2f& startPos, const cv::Point2f& startVel) const {
+    EntryPrediction entry;
+    cv::Point2f pos = startPos;
+    double vx = startVel.x, vy = startVel.y;
 
     // Reject if puck has negligible velocity (standing still or nearly still)
     double velocityMagnitude = std::hypot(vx, vy);
     const double MIN_VELOCITY_THRESHOLD = 5.0;  // mm/s
     if (velocityMagnitude < MIN_VELOCITY_THRESHOLD) {
-        return cv::Point2f(-1, -1);
+        return entry;
     }
 
     // If already in zone, return current position
     if (pos.y <= zoneYMax && pos.y >= zoneYMin && pos.x >= zoneXMin && pos.x <= zoneXMax) {
-        return pos;
+        entry.valid = true;
+        entry.point = pos;
+        entry.velocity = startVel;
+        return entry;
     }
 
-    // Reject if moving away from the defense zone
-    switch (currentZoneIndex_) {
-        case 0: // Left defense zone if negative x return false
-            if ( vx >= 0) return cv::Point2f(-1, -1);
-            break;
-        case 1: // Right defense zone if positive x return false
-            if (vx <= 0) return cv::Point2f(-1, -1);
-            break;
-        case 2: // Top defense zone if positive y return false
-            if (vy >= 0) return cv::Point2f(-1, -1);
-            break;
-        case 3: // Bottom defense zone if negative y return false
-            if (vy >= 0) return cv::Point2f(-1, -1);
-            break;
-        default:
-            break;
-    }
+    // Reject if moving away from the defense zone: depth must shrink in the zone's frame
+    if (stopWall_ < 0 || zoneFrame_.mapVector(startVel).y >= 0) return entry;
 
     auto computeInterval = [&](double p, double v, double minVal, double maxVal, double& start, double& end) {
         if (minVal > maxVal) std::swap(minVal, maxVal);
@@ -156,6 +723,13 @@ cv::Point2f TrajectoryPredictor::predictEntryToDefenseZone(uint64_t currentTimes
         return true;
     };
 
+    // Everything below is solved in travel u (see AxisMotion) and mapped back to time at the
+    // end; with a glide decay k the puck stops at u = 1/k
+    const double decay = config_.GLIDE_DECAY;
+    const double travelLimit = decay > 0.0 ? 1.0 / decay : std::numeric_limits<double>::infinity();
+    auto travelAt = [&](double t) { return decay > 0.0 ? -std::expm1(-decay * t) / decay : t; };
+    auto timeAt = [&](double u) { return decay > 0.0 ? -std::log1p(-decay * u) / decay : u; };
+
     // Fast path: check if direct trajectory crosses zone without bounces
     double tZoneStart, tZoneEnd;
     bool xInZone = computeInterval(pos.x, vx, zoneXMin, zoneXMax, tZoneStart, tZoneEnd);
@@ -165,121 +739,208 @@ cv::Point2f TrajectoryPredictor::predictEntryToDefenseZone(uint64_t currentTimes
     if (xInZone && yInZone) {
         double entryStart = std::max(tZoneStart, yZoneStart);
         double entryEnd = std::min(tZoneEnd, yZoneEnd);
-        if (entryStart <= entryEnd && entryStart >= 0.0) {
-            return cv::Point2f(pos.x + vx * entryStart, pos.y + vy * entryStart);
+        if (entryStart <= entryEnd && entryStart >= 0.0 && entryStart < travelLimit) {
+            entry.valid = true;
+            entry.point = cv::Point2f(pos.x + vx * entryStart, pos.y + vy * entryStart);
+            entry.velocity = startVel * (float)(1.0 - decay * entryStart);
+            entry.timeS = timeAt(entryStart);
+            return entry;
         }
     }
 
+    // Bounce path. The approach axis is the one facing the defense zone; the prediction ends
+    // when the puck reaches the stop wall on that axis, so it has at most two legs to check.
+    // The other axis may bounce several times and is solved from its tabulated legs.
     const double maxTime = 2.0; // 2s
-    const int maxBounces = 5;
-    double timeAccum = 0.0;
-
-    for (int bounce = 0; bounce < maxBounces && timeAccum < maxTime; ++bounce) {
-        double tx_left = std::numeric_limits<double>::infinity();
-        double tx_right = std::numeric_limits<double>::infinity();
-        double ty_bottom = std::numeric_limits<double>::infinity();
-        double ty_top = std::numeric_limits<double>::infinity();
-
-        if (vx < 0.0) tx_left = -pos.x / vx;
-        else if (vx > 0.0) tx_right = (config_.PHYSICAL_TABLE_WIDTH - pos.x) / vx;
-
-        if (vy < 0.0) ty_bottom = -pos.y / vy;
-        else if (vy > 0.0) ty_top = (config_.PHYSICAL_TABLE_HEIGHT - pos.y) / vy;
-
-        double minTime = std::min({tx_left, tx_right, ty_bottom, ty_top});
-        int wall = -1;
-        if (minTime == tx_left) wall = 0;
-        else if (minTime == tx_right) wall = 1;
-        else if (minTime == ty_bottom) wall = 2;
-        else if (minTime == ty_top) wall = 3;
-
-        xInZone = computeInterval(pos.x, vx, zoneXMin, zoneXMax, tZoneStart, tZoneEnd);
-        yInZone = computeInterval(pos.y, vy, zoneYMin, zoneYMax, yZoneStart, yZoneEnd);
-
-        if (xInZone && yInZone) {
-            double entryStart = std::max(tZoneStart, yZoneStart);
-            double entryEnd = std::min(tZoneEnd, yZoneEnd);
-            if (entryStart <= entryEnd && entryStart >= 0.0 && entryStart <= minTime && timeAccum + entryStart <= maxTime) {
-                return cv::Point2f(pos.x + vx * entryStart, pos.y + vy * entryStart);
+    const double maxTravel = travelAt(maxTime);
+    const int maxBounces = 4;
+    bool approachX = zoneFrame_.axis[1] == 0;
+    AxisMotion motionX(pos.x, vx, config_.wallCoordinate(0), config_.wallCoordinate(1), config_.wallRestitution(0), config_.wallRestitution(1));
+    AxisMotion motionY(pos.y, vy, config_.wallCoordinate(2), config_.wallCoordinate(3), config_.wallRestitution(2), config_.wallRestitution(3));
+    const AxisMotion& approach = approachX ? motionX : motionY;
+    const AxisMotion& cross = approachX ? motionY : motionX;
+    double approachMin = approachX ? zoneXMin : zoneYMin;
+    double approachMax = approachX ? zoneXMax : zoneYMax;
+    double crossMin = approachX ? zoneYMin : zoneXMin;
+    double crossMax = approachX ? zoneYMax : zoneXMax;
+    int stopSide = (stopWall_ % 2 == 1) ? 1 : -1;
+
+    // Starting beyond the stop wall and moving out of the table
+    if (approach.initialHits > 0 && approach.hitSide(0) != stopSide) return entry;
+
+    double entryTravel = std::numeric_limits<double>::infinity();
+    for (int leg = 0; leg < 2 && entryTravel == std::numeric_limits<double>::infinity(); ++leg) {
+        double legStart = approach.legStartTime(leg);
+        if (legStart > maxTravel) break;
+        double legEnd = approach.hitTime(leg);
+
+        double start, end;
+        if (computeInterval(approach.legStart(leg), approach.legVelocity(leg), approachMin, approachMax, start, end)) {
+            start += legStart;
+            end = std::min(end + legStart, legEnd);
+            if (start <= end) {
+                double t = cross.firstTimeIn(crossMin, crossMax, start);
+                if (t <= end) entryTravel = t;
             }
         }
+        if (approach.hitSide(leg) == stopSide) break;
+    }
 
-        if (minTime == std::numeric_limits<double>::infinity()) break;
-        if (timeAccum + minTime > maxTime) break;
-
-        // stop if we hit the opposite wall for the defense zone
-        bool stop = false;
-        switch (currentZoneIndex_) {
-            case 0: if (wall == 1) stop = true; break; 
-            case 1: if (wall == 0) stop = true; break;
-            case 2: if (wall == 2) stop = true; break; 
-            case 3: if (wall == 3) stop = true; break; 
-            default: break;
-        }
-        if (stop) break;
-
-        // Advance to the bounce point and reflect
-        pos.x += vx * minTime;
-        pos.y += vy * minTime;
-        timeAccum += minTime;
-
-        switch (wall) {
-            case 0: vx = -vx; break;
-            case 1: vx = -vx; break;
-            case 2: vy = -vy; break;
-            case 3: vy = -vy; break;
-            default: break;
+    if (entryTravel > maxTravel) return entry;
+    int bounces = motionX.hitsBefore(entryTravel) + motionY.hitsBefore(entryTravel);
+    if (bounces > maxBounces) return entry;
+
+    double speedLeft = 1.0 - decay * entryTravel;  // e^(-kt) at the entry
+    entry.valid = true;
+    entry.point = cv::Point2f(motionX.position(entryTravel), motionY.position(entryTravel));
+    entry.velocity = cv::Point2f(motionX.velocity(entryTravel) * speedLeft, motionY.velocity(entryTravel) * speedLeft);
+    entry.timeS = timeAt(entryTravel);
+    entry.bounces = bounces;
+    return entry;
+}
+// Unscented transform of the full state covariance through the entry solver: 2n+1 sigma
+// points, each solved for its own entry, then weighted over the ones that reach the zone
+EntryDistribution TrajectoryPredictor::predictEntryDistribution() const {
+    EntryDistribution distribution;
+    EntryPrediction center = predictEntry();
+    if (!center.valid) return distribution;
+
+    const int n = 4;
+    const double kappa = 1.0;
+    const KalmanFilter::StateVector& state = kalmanFilter_.getState();
+    Eigen::LLT<KalmanFilter::StateMatrix> llt((n + kappa) * kalmanFilter_.getCovariance());
+
+    const int maxPoints = 2 * n + 1;
+    EntryPrediction entries[maxPoints];
+    double weights[maxPoints];
+    int points = 1;
+    entries[0] = center;
+    weights[0] = kappa / (n + kappa);
+    if (llt.info() == Eigen::Success) {
+        KalmanFilter::StateMatrix L = llt.matrixL();
+        for (int i = 0; i < n; ++i) {
+            for (int sign : {1, -1}) {
+                KalmanFilter::StateVector sigma = state + sign * L.col(i);
+                entries[points] = solveEntry(cv::Point2f(sigma(0), sigma(1)), cv::Point2f(sigma(2), sigma(3)));
+                weights[points] = 0.5 / (n + kappa);
+                points++;
+            }
         }
+    } else {
+        weights[0] = 1.0;  // covariance not positive definite, fall back to the point estimate
+    }
+
+    double weightSum = 0.0, meanX = 0.0, meanY = 0.0, meanT = 0.0;
+    for (int i = 0; i < points; ++i) {
+        if (!entries[i].valid) continue;
+        weightSum += weights[i];
+        meanX += weights[i] * entries[i].point.x;
+        meanY += weights[i] * entries[i].point.y;
+        meanT += weights[i] * entries[i].timeS;
     }
+    meanX /= weightSum;
+    meanY /= weightSum;
+    meanT /= weightSum;
+
+    double varLateral = 0.0, varT = 0.0;
+    for (int i = 0; i < points; ++i) {
+        if (!entries[i].valid) continue;
+        double d = zoneFrame_.mapVector(entries[i].point - cv::Point2f(meanX, meanY)).x;  // along the goal line
+        varLateral += weights[i] * d * d;
+        varT += weights[i] * (entries[i].timeS - meanT) * (entries[i].timeS - meanT);
+    }
+
+    distribution.valid = true;
+    distribution.mean = cv::Point2f(meanX, meanY);
+    distribution.lateralStd = std::sqrt(varLateral / weightSum);
+    distribution.timeS = meanT;
+    distribution.timeStdS = std::sqrt(varT / weightSum);
+    distribution.timestamp = lastTimestamp_ + (uint64_t)(meanT * 1000000.0);
+    distribution.validFraction = weightSum;
+    return distribution;
+}
 
-    return cv::Point2f(-1, -1);
+// Target on the goal line: the mean entry when the spread is tight, pulled toward the goal
+// centre as the lateral spread grows or fewer sigma points reach the zone
+cv::Point2f TrajectoryPredictor::hedgeEntry(const EntryDistribution& distribution) const {
+    double hedgeSpread = config_.ENTRY_HEDGE_SPREAD_MM;
+    double variance = distribution.lateralStd * distribution.lateralStd;
+    double pull = hedgeSpread > 0.0 ? variance / (variance + hedgeSpread * hedgeSpread) : 0.0;
+    pull = std::max(pull, 1.0 - distribution.validFraction);
+
+    cv::Point2f target = zoneFrame_.map(distribution.mean);
+    cv::Point2f centre = zoneFrame_.map(cv::Point2f((zoneXMin + zoneXMax) / 2.0, (zoneYMin + zoneYMax) / 2.0));
+    target.x += pull * (centre.x - target.x);
+    return zoneFrame_.inverse().map(target);
 }
 void TrajectoryPredictor::reset() {
+    resetTrack();
+    historyStart_ = 0;
+    historyCount_ = 0;
+    publishSnapshot();
+}
+void TrajectoryPredictor::resetTrack() {
     initialized_ = false;
+    initCount_ = 0;
+    eventCandidate_.valid = false;
+    lineFit_.reset();
     lastTimestamp_ = 0;
+    trajectoryValid_ = false;
     kalmanFilter_.reset();
+    configureModels();
+}
+void TrajectoryPredictor::setEstimator(TrajectoryEstimator estimator) {
+    estimator_ = estimator;
+    reset();
 }
 bool TrajectoryPredictor::isInDefenseZone(const cv::Point2f& pos) {
     return (pos.y <= zoneYMax && pos.y >= zoneYMin && pos.x >= zoneXMin && pos.x <= zoneXMax);
 }
+// The zone's frame puts the goal line at depth 0 with the table ahead of it; the zone is
+// DEFENSE_ZONE_WIDTH wide, centred on the goal line, and DEFENSE_ZONE_HEIGHT deep.
+// Zones: 0 = left (x = 0), 1 = right (x = max), 2 = top (y = 0), 3 = bottom (y = max).
 void TrajectoryPredictor::setDefenseZone(int zoneIndex) {
     currentZoneIndex_ = zoneIndex;
-    switch (currentZoneIndex_) {
-    case 0: // Left defense zone
-        zoneYMin = (config_.PHYSICAL_TABLE_HEIGHT - config_.DEFENSE_ZONE_WIDTH) / 2.0;
-        zoneYMax = (config_.PHYSICAL_TABLE_HEIGHT + config_.DEFENSE_ZONE_WIDTH) / 2.0;
-        zoneXMin = 0;
-        zoneXMax = config_.DEFENSE_ZONE_HEIGHT;
-        break;
-    case 1: // Right defense zone
-        zoneYMin = (config_.PHYSICAL_TABLE_HEIGHT - config_.DEFENSE_ZONE_WIDTH) / 2.0;
-        zoneYMax = (config_.PHYSICAL_TABLE_HEIGHT + config_.DEFENSE_ZONE_WIDTH) / 2.0;
-        zoneXMin = config_.PHYSICAL_TABLE_WIDTH - config_.DEFENSE_ZONE_HEIGHT;
-        zoneXMax = config_.PHYSICAL_TABLE_WIDTH;
-        break;
-    case 2: // Top defense zone
-        zoneYMin = 0;
-        zoneYMax = config_.DEFENSE_ZONE_HEIGHT;
-        zoneXMin = (config_.PHYSICAL_TABLE_WIDTH - config_.DEFENSE_ZONE_WIDTH) / 2.0;
-        zoneXMax = (config_.PHYSICAL_TABLE_WIDTH + config_.DEFENSE_ZONE_WIDTH) / 2.0;
-
-        break;
-    case 3: // Bottom defense zone
-        zoneYMin = config_.PHYSICAL_TABLE_HEIGHT - config_.DEFENSE_ZONE_HEIGHT;
-        zoneYMax = config_.PHYSICAL_TABLE_HEIGHT;
-        zoneXMin = (config_.PHYSICAL_TABLE_WIDTH - config_.DEFENSE_ZONE_WIDTH) / 2.0;
-        zoneXMax = (config_.PHYSICAL_TABLE_WIDTH + config_.DEFENSE_ZONE_WIDTH) / 2.0;
-        break;
-    
-    default:
-        break;
+    trajectoryValid_ = false;
+    if (zoneIndex < 0 || zoneIndex > 3) {
+        stopWall_ = -1;
+        publishSnapshot();
+        return;
     }
+
+    const float width = config_.PHYSICAL_TABLE_WIDTH, height = config_.PHYSICAL_TABLE_HEIGHT;
+    const AxisMap frames[4] = {
+        AxisMap(1, 1.0f, 0.0f, 0, 1.0f, 0.0f),      // lateral y, depth x
+        AxisMap(1, 1.0f, 0.0f, 0, -1.0f, width),    // lateral y, depth max x - x
+        AxisMap(0, 1.0f, 0.0f, 1, 1.0f, 0.0f),      // lateral x, depth y
+        AxisMap(0, 1.0f, 0.0f, 1, -1.0f, height)};  // lateral x, depth max y - y
+    zoneFrame_ = frames[zoneIndex];
+    const int depthAxis = zoneFrame_.axis[1];
+    stopWall_ = 2 * depthAxis + (zoneFrame_.sign[1] > 0.0f ? 1 : 0);
+
+    double goalWall = depthAxis == 0 ? height : width;  // length of the wall behind the zone
+    AxisMap toTable = zoneFrame_.inverse();
+    cv::Point2f a = toTable.map(cv::Point2f((goalWall - config_.DEFENSE_ZONE_WIDTH) / 2.0, 0.0f));
+    cv::Point2f b = toTable.map(cv::Point2f((goalWall + config_.DEFENSE_ZONE_WIDTH) / 2.0, config_.DEFENSE_ZONE_HEIGHT));
+    zoneXMin = std::min(a.x, b.x);
+    zoneXMax = std::max(a.x, b.x);
+    zoneYMin = std::min(a.y, b.y);
+    zoneYMax = std::max(a.y, b.y);
+    publishSnapshot();
 }
 double TrajectoryPredictor::getVelocityConfidence() {
-    Eigen::MatrixXd P = kalmanFilter_.getCovariance();
+    const KalmanFilter::StateMatrix& P = kalmanFilter_.getCovariance();
     double varVx = P(2, 2);
     double varVy = P(3, 3);
     double confidenceVx = 1.0 / (1.0 + varVx); 
     double confidenceVy = 1.0 / (1.0 + varVy);
     return std::min(confidenceVx, confidenceVy); 
 }
+cv::Point2f TrajectoryPredictor::getPosition() const {
+    const KalmanFilter::StateVector& state = kalmanFilter_.getState();
+    return cv::Point2f(state(0), state(1));
+}
+cv::Point2f TrajectoryPredictor::getVelocity() const {
+    const KalmanFilter::StateVector& state = kalmanFilter_.getState();
+    return cv::Point2f(state(2), state(3));
+}